@@ -0,0 +1,43 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "crow.h"
+
+// One row of the lists API. The id is kept as a string so that PostgreSQL's
+// serial ids and MongoDB's ObjectIds fit the same interface; each service
+// formats it the way its JSON always has.
+struct ListItem
+{
+    std::string id;
+    std::string list;
+};
+
+// Storage behind the /lists routes, shared by the C++ services.
+//
+// Every call is a coroutine so that a repository backed by a blocking driver
+// can run on a crow::executor and resume the handler afterwards, while one
+// that has the answer at hand simply returns without suspending. The request
+// is only used to find the io thread to resume on. Errors are thrown.
+class ListRepository
+{
+public:
+    virtual ~ListRepository() = default;
+
+    /// Store a new list and return it with its id.
+    virtual crow::task<ListItem> create(const crow::request& req, std::string list) = 0;
+
+    /// Every list, in id order.
+    virtual crow::task<std::vector<ListItem>> all(const crow::request& req) = 0;
+
+    /// nullopt if there is no list with that id.
+    virtual crow::task<std::optional<ListItem>> get(const crow::request& req, std::string id) = 0;
+
+    /// Replace a list and return its new value; nullopt if there is no list with that id.
+    virtual crow::task<std::optional<ListItem>> update(const crow::request& req, std::string id, std::string list) = 0;
+
+    /// Returns false if there is no list with that id.
+    virtual crow::task<bool> remove(const crow::request& req, std::string id) = 0;
+};
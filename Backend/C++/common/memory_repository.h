@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "list_repository.h"
+
+// Lists kept in process memory, for measuring the HTTP stack without a
+// database behind it. Nothing survives a restart.
+//
+// Items are spread over independently locked stripes by id, so concurrent
+// requests only contend when they touch the same stripe. Ids are handed out
+// sequentially, which sends consecutive inserts to different stripes. Listing
+// everything visits the stripes one at a time, so it is not a snapshot of a
+// single instant while writes are going on.
+//
+// No call ever suspends; handlers resume immediately on their own io thread.
+class MemoryListRepository : public ListRepository
+{
+public:
+    crow::task<ListItem> create(const crow::request&, std::string list) override
+    {
+        uint64_t id = next_id_.fetch_add(1, std::memory_order_relaxed);
+        stripe& s = stripe_for(id);
+        {
+            std::unique_lock<std::shared_mutex> lock(s.mutex);
+            s.items.emplace(id, list);
+        }
+        co_return ListItem{std::to_string(id), std::move(list)};
+    }
+
+    crow::task<std::vector<ListItem>> all(const crow::request&) override
+    {
+        std::vector<std::pair<uint64_t, std::string>> items;
+        for (stripe& s : stripes_)
+        {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            items.insert(items.end(), s.items.begin(), s.items.end());
+        }
+        std::sort(items.begin(), items.end());
+
+        std::vector<ListItem> lists;
+        lists.reserve(items.size());
+        for (auto& item : items)
+            lists.push_back(ListItem{std::to_string(item.first), std::move(item.second)});
+        co_return lists;
+    }
+
+    crow::task<std::optional<ListItem>> get(const crow::request&, std::string id) override
+    {
+        auto key = parse_id(id);
+        if (!key)
+            co_return std::nullopt;
+        stripe& s = stripe_for(*key);
+        std::shared_lock<std::shared_mutex> lock(s.mutex);
+        auto it = s.items.find(*key);
+        if (it == s.items.end())
+            co_return std::nullopt;
+        co_return ListItem{std::move(id), it->second};
+    }
+
+    crow::task<std::optional<ListItem>> update(const crow::request&, std::string id, std::string list) override
+    {
+        auto key = parse_id(id);
+        if (!key)
+            co_return std::nullopt;
+        stripe& s = stripe_for(*key);
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        auto it = s.items.find(*key);
+        if (it == s.items.end())
+            co_return std::nullopt;
+        it->second = list;
+        co_return ListItem{std::move(id), std::move(list)};
+    }
+
+    crow::task<bool> remove(const crow::request&, std::string id) override
+    {
+        auto key = parse_id(id);
+        if (!key)
+            co_return false;
+        stripe& s = stripe_for(*key);
+        std::unique_lock<std::shared_mutex> lock(s.mutex);
+        co_return s.items.erase(*key) > 0;
+    }
+
+private:
+    static constexpr size_t stripe_count = 64;
+
+    // Own cache line each, so that stripes do not contend through false sharing.
+    struct alignas(64) stripe
+    {
+        std::shared_mutex mutex;
+        std::unordered_map<uint64_t, std::string> items;
+    };
+
+    static std::optional<uint64_t> parse_id(const std::string& id)
+    {
+        uint64_t key;
+        auto end = id.data() + id.size();
+        auto result = std::from_chars(id.data(), end, key);
+        if (result.ec != std::errc() || result.ptr != end)
+            return std::nullopt;
+        return key;
+    }
+
+    stripe& stripe_for(uint64_t id)
+    {
+        return stripes_[id % stripe_count];
+    }
+
+    std::array<stripe, stripe_count> stripes_;
+    std::atomic<uint64_t> next_id_{1};
+};
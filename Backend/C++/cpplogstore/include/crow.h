@@ -0,0 +1,39 @@
+#pragma once
+#include "crow/query_string.h"
+#include "crow/http_parser_merged.h"
+#include "crow/ci_map.h"
+#include "crow/TinySHA1.hpp"
+#include "crow/settings.h"
+#include "crow/socket_adaptors.h"
+#include "crow/json.h"
+#include "crow/mustache.h"
+#include "crow/logging.h"
+#include "crow/task_timer.h"
+#include "crow/thread_affinity.h"
+#include "crow/core_context.h"
+#include "crow/utility.h"
+#include "crow/common.h"
+#include "crow/http_request.h"
+#include "crow/websocket.h"
+#include "crow/fast_parser.h"
+#include "crow/parser.h"
+#include "crow/file_cache.h"
+#include "crow/asset_cache.h"
+#include "crow/http_response.h"
+#include "crow/multipart.h"
+#include "crow/multipart_view.h"
+#include "crow/routing.h"
+#include "crow/middleware.h"
+#include "crow/middleware_context.h"
+#include "crow/compression.h"
+#include "crow/load_balancer.h"
+#include "crow/connection_pool.h"
+#include "crow/request_arena.h"
+#include "crow/http_date.h"
+#include "crow/hpack.h"
+#include "crow/http2.h"
+#include "crow/http_connection.h"
+#include "crow/http_server.h"
+#include "crow/executor.h"
+#include "crow/task.h"
+#include "crow/app.h"
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "crow/settings.h"
+#include "crow/file_cache.h"
+#include "crow/compression.h"
+#include "crow/logging.h"
+#include "crow/utility.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// A small static file held in memory, with its compressed variants and their headers worked out in advance.
+        struct static_asset
+        {
+            struct variant
+            {
+                std::string encoding; ///< Content-Encoding, empty for the file as is.
+                std::string etag;
+                std::string content_length;
+                std::shared_ptr<const std::string> data;
+
+                std::string sibling;        ///< For `br` and `gzip`, the path of the precompressed file next to the original.
+                bool sibling_found = false; ///< Whether it was there when the asset was loaded, used or not.
+                struct stat sibling_stat{}; ///< Its `stat` then, to notice when it is replaced, added or removed.
+            };
+
+            struct stat statbuf; ///< Of the file the variants were loaded from.
+            variant identity;
+            variant gzip;
+            variant br;
+
+            bool has_encodings() const
+            {
+                return gzip.data || br.data;
+            }
+
+            std::size_t size() const
+            {
+                std::size_t total = 0;
+                for (const variant* v : {&identity, &gzip, &br})
+                    if (v->data)
+                        total += v->data->size();
+                return total;
+            }
+
+            /// The smallest variant the client accepts, going by its `Accept-Encoding` header.
+            const variant& pick(const std::string& accept_encoding) const
+            {
+                if (br.data && accepts(accept_encoding, "br"))
+                    return br;
+                if (gzip.data && accepts(accept_encoding, "gzip"))
+                    return gzip;
+                return identity;
+            }
+
+            /// Whether `coding` is listed in `accept_encoding` (directly or through `*`) with a non-zero quality.
+            static bool accepts(const std::string& accept_encoding, const std::string& coding)
+            {
+                bool wildcard = false;
+                size_t pos = 0;
+                while (pos < accept_encoding.size())
+                {
+                    size_t comma = accept_encoding.find(',', pos);
+                    if (comma == std::string::npos)
+                        comma = accept_encoding.size();
+                    size_t name_begin = accept_encoding.find_first_not_of(" \t", pos);
+                    size_t name_end = accept_encoding.find_first_of(" \t;", name_begin);
+                    if (name_end == std::string::npos || name_end > comma)
+                        name_end = comma;
+
+                    bool acceptable = true;
+                    size_t q = accept_encoding.find("q=", name_end);
+                    if (q != std::string::npos && q < comma)
+                        acceptable = std::strtod(accept_encoding.c_str() + q + 2, nullptr) > 0;
+
+                    if (name_begin < name_end)
+                    {
+                        std::string name = accept_encoding.substr(name_begin, name_end - name_begin);
+                        if (utility::string_equals(name, coding))
+                            return acceptable;
+                        if (name == "*")
+                            wildcard = acceptable;
+                    }
+                    pos = comma + 1;
+                }
+                return wildcard;
+            }
+        };
+
+        /// Keeps small static files in memory, along with `.br` and `.gz` siblings found next to them on disk.
+
+        ///
+        /// A file is loaded the first time it is requested, and again (siblings included) whenever it or one of its
+        /// siblings changes on disk, or a sibling appears or goes away. With `CROW_ENABLE_COMPRESSION`, a file without a `.gz` sibling is gzipped once at load time if that
+        /// makes it smaller. Either way nothing is compressed per request. Files over `CROW_STATIC_ASSET_MAX_SIZE` are
+        /// left to the sendfile path, and the least recently used assets are dropped to stay within
+        /// `CROW_STATIC_ASSET_CACHE_SIZE` bytes.
+        class asset_cache
+        {
+        public:
+            asset_cache(std::size_t capacity, std::size_t max_file_size):
+              capacity_(capacity), max_file_size_(max_file_size)
+            {}
+
+            /// The cache used for responses set up with \ref response::set_static_file_info().
+            static asset_cache& global()
+            {
+                static asset_cache cache(CROW_STATIC_ASSET_CACHE_SIZE, CROW_STATIC_ASSET_MAX_SIZE);
+                return cache;
+            }
+
+            /// The in-memory copy of `file` (opened from `path`), or nullptr if it is too large to keep.
+
+            ///
+            /// A cached copy is used as long as neither the file nor its `.br` and `.gz` siblings have changed on disk,
+            /// which takes a `stat` of each sibling per request.
+            std::shared_ptr<const static_asset> get(const std::string& path, const cached_file& file)
+            {
+                if (static_cast<uint64_t>(file.statbuf.st_size) > max_file_size_)
+                    return nullptr;
+
+                std::shared_ptr<const static_asset> cached;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = index_.find(path);
+                    if (it != index_.end())
+                        cached = it->second->second;
+                }
+                if (cached && file.same_as(cached->statbuf) && sibling_unchanged(cached->br) && sibling_unchanged(cached->gzip))
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = index_.find(path);
+                    if (it != index_.end() && it->second->second == cached)
+                        lru_.splice(lru_.begin(), lru_, it->second);
+                    return cached;
+                }
+
+                auto asset = load(path, file);
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = index_.find(path);
+                if (it != index_.end())
+                {
+                    size_ -= it->second->second->size();
+                    lru_.erase(it->second);
+                    index_.erase(it);
+                }
+                if (!asset)
+                    return nullptr;
+                lru_.emplace_front(path, asset);
+                index_.emplace(path, lru_.begin());
+                size_ += asset->size();
+                while (size_ > capacity_ && lru_.size() > 1)
+                {
+                    size_ -= lru_.back().second->size();
+                    index_.erase(lru_.back().first);
+                    lru_.pop_back();
+                }
+                return asset;
+            }
+
+        private:
+            std::shared_ptr<const static_asset> load(const std::string& path, const cached_file& file)
+            {
+                auto asset = std::make_shared<static_asset>();
+                asset->statbuf = file.statbuf;
+
+                std::string data(static_cast<std::size_t>(file.statbuf.st_size), '\0');
+                if (file.read(&data[0], data.size(), 0) != data.size())
+                    return nullptr;
+
+                // Strong validators: a different representation gets a different tag.
+                set_variant(asset->identity, "", etag(file.statbuf, ""), std::move(data));
+
+                std::string br;
+                if (read_sibling(path + ".br", file, asset->br, br))
+                    set_variant(asset->br, "br", etag(asset->br.sibling_stat, "-br"), std::move(br));
+                std::string gzip;
+                if (read_sibling(path + ".gz", file, asset->gzip, gzip))
+                    set_variant(asset->gzip, "gzip", etag(asset->gzip.sibling_stat, "-gz"), std::move(gzip));
+#ifdef CROW_ENABLE_COMPRESSION
+                else
+                {
+                    // Made from the file itself, so it goes by the file's tag.
+                    gzip = compression::compress_string(*asset->identity.data, compression::algorithm::GZIP);
+                    if (!gzip.empty() && gzip.size() < asset->identity.data->size())
+                        set_variant(asset->gzip, "gzip", etag(file.statbuf, "-gz"), std::move(gzip));
+                }
+#endif
+                CROW_LOG_DEBUG << "Static asset " << path << " loaded (" << asset->size() << " bytes with variants)";
+                return asset;
+            }
+
+            static void set_variant(static_asset::variant& variant, std::string encoding, std::string etag, std::string data)
+            {
+                variant.encoding = std::move(encoding);
+                variant.etag = std::move(etag);
+                variant.content_length = std::to_string(data.size());
+                variant.data = std::make_shared<const std::string>(std::move(data));
+            }
+
+            /// An ETag from the modification time and size of the file a variant was read from.
+            static std::string etag(const struct stat& statbuf, const char* suffix)
+            {
+                char tag[64];
+                snprintf(tag, sizeof(tag), "\"%llx-%llx%s\"", static_cast<unsigned long long>(statbuf.st_mtime), static_cast<unsigned long long>(statbuf.st_size), suffix);
+                return tag;
+            }
+
+            /// Whether a variant's sibling is still the file it was when the asset was loaded, or still missing.
+            static bool sibling_unchanged(const static_asset::variant& variant)
+            {
+                struct stat current;
+                bool found = stat(variant.sibling.c_str(), &current) == 0 && S_ISREG(current.st_mode);
+                return found == variant.sibling_found && (!found || same_file(current, variant.sibling_stat));
+            }
+
+            /// A precompressed sibling is only trusted if it is at least as new as the file itself.
+
+            ///
+            /// Records in `variant` what was found at `path` either way, for \ref sibling_unchanged().
+            bool read_sibling(const std::string& path, const cached_file& original, static_asset::variant& variant, std::string& data)
+            {
+                auto sibling = file_cache::global().open(path);
+                variant.sibling = path;
+                variant.sibling_found = sibling != nullptr;
+                if (sibling)
+                    variant.sibling_stat = sibling->statbuf;
+                if (!sibling || sibling->statbuf.st_mtime < original.statbuf.st_mtime ||
+                    static_cast<uint64_t>(sibling->statbuf.st_size) > max_file_size_)
+                    return false;
+                data.resize(static_cast<std::size_t>(sibling->statbuf.st_size));
+                return sibling->read(&data[0], data.size(), 0) == data.size();
+            }
+
+            using entry = std::pair<std::string, std::shared_ptr<const static_asset>>;
+
+            std::mutex mutex_;
+            std::list<entry> lru_;
+            std::unordered_map<std::string, std::list<entry>::iterator> index_;
+            std::size_t size_ = 0;
+            std::size_t capacity_;
+            std::size_t max_file_size_;
+        };
+    } // namespace detail
+} // namespace crow
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "crow/utility.h"
+
+namespace crow
+{
+    namespace detail
+    {
+        /// Lower case for ASCII letters, every other byte as it is.
+        inline constexpr unsigned char ascii_lower(char c)
+        {
+            unsigned char u = static_cast<unsigned char>(c);
+            return (u >= 'A' && u <= 'Z') ? u | 0x20 : u;
+        }
+
+        /// Compare two header names the way HTTP does, ignoring the case of ASCII letters.
+        inline bool ci_equal(std::string_view l, std::string_view r)
+        {
+            if (l.size() != r.size())
+                return false;
+            for (size_t i = 0; i < l.size(); i++)
+            {
+                if (l[i] != r[i] && ascii_lower(l[i]) != ascii_lower(r[i]))
+                    return false;
+            }
+            return true;
+        }
+    } // namespace detail
+
+    /// Hashing function for case insensitive maps (FNV-1a over the ASCII lower case of the key).
+    struct ci_hash
+    {
+        size_t operator()(const std::string_view key) const
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (auto c : key)
+            {
+                hash ^= detail::ascii_lower(c);
+                hash *= 1099511628211ull;
+            }
+            return static_cast<size_t>(hash);
+        }
+    };
+
+    /// Equals function for case insensitive maps.
+    struct ci_key_eq
+    {
+        bool operator()(const std::string_view l, const std::string_view r) const
+        {
+            return detail::ci_equal(l, r);
+        }
+    };
+
+    /// Case insensitive multimap of HTTP headers, kept in one flat array in the order they were added.
+
+    ///
+    /// Requests and responses have a handful of headers, so a lookup just walks the array, comparing lengths first,
+    /// which beats hashing the key. Names and values are plain `std::string`s. The array holding them comes from a
+    /// `std::pmr::memory_resource`, the heap unless one is given. A map made by copying or moving another one always
+    /// uses the heap, so it outlives the memory of the connection that parsed a \ref crow::request. clear() keeps the
+    /// array for the next headers.
+    class ci_map
+    {
+    public:
+        using key_type = std::string;
+        using mapped_type = std::string;
+        using value_type = std::pair<std::string, std::string>;
+        using allocator_type = std::pmr::polymorphic_allocator<value_type>;
+        using size_type = size_t;
+        using iterator = std::pmr::vector<value_type>::iterator;
+        using const_iterator = std::pmr::vector<value_type>::const_iterator;
+
+        ci_map() = default;
+
+        explicit ci_map(const allocator_type& allocator):
+          entries_(allocator)
+        {}
+
+        ci_map(std::initializer_list<value_type> headers):
+          entries_(headers)
+        {}
+
+        ci_map(const ci_map& other):
+          entries_(other.entries_, allocator_type())
+        {}
+
+        /// Takes the array over if `other` uses the heap, moves the headers into a new one on the heap otherwise.
+        ci_map(ci_map&& other):
+          entries_(std::move(other.entries_), allocator_type())
+        {}
+
+        /// Both keep the memory resource of this map, moving or copying the headers over if `other` has another one.
+        ci_map& operator=(const ci_map& other) = default;
+        ci_map& operator=(ci_map&& other) = default;
+
+        template<typename Key, typename Value>
+        iterator emplace(Key&& key, Value&& value)
+        {
+            if (entries_.capacity() == 0)
+                entries_.reserve(initial_capacity);
+            entries_.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<Key>(key)), std::forward_as_tuple(std::forward<Value>(value)));
+            return entries_.end() - 1;
+        }
+
+        iterator insert(value_type header)
+        {
+            if (entries_.capacity() == 0)
+                entries_.reserve(initial_capacity);
+            entries_.push_back(std::move(header));
+            return entries_.end() - 1;
+        }
+
+        /// The first header with this name, or end().
+        iterator find(std::string_view key)
+        {
+            return entries_.begin() + index_of(key);
+        }
+
+        const_iterator find(std::string_view key) const
+        {
+            return entries_.begin() + index_of(key);
+        }
+
+        size_type count(std::string_view key) const
+        {
+            size_type n = 0;
+            for (auto& header : entries_)
+                n += detail::ci_equal(header.first, key);
+            return n;
+        }
+
+        bool contains(std::string_view key) const
+        {
+            return index_of(key) != entries_.size();
+        }
+
+        /// Remove every header with this name, returns how many there were.
+        size_type erase(std::string_view key)
+        {
+            auto kept = entries_.begin();
+            for (auto it = entries_.begin(); it != entries_.end(); ++it)
+            {
+                if (!detail::ci_equal(it->first, key))
+                {
+                    if (kept != it)
+                        *kept = std::move(*it);
+                    ++kept;
+                }
+            }
+            size_type removed = entries_.end() - kept;
+            entries_.erase(kept, entries_.end());
+            return removed;
+        }
+
+        iterator erase(const_iterator position)
+        {
+            return entries_.erase(position);
+        }
+
+        void clear() { entries_.clear(); }
+        void reserve(size_type n) { entries_.reserve(n); }
+        size_type size() const { return entries_.size(); }
+        bool empty() const { return entries_.empty(); }
+        allocator_type get_allocator() const { return entries_.get_allocator(); }
+
+        iterator begin() { return entries_.begin(); }
+        iterator end() { return entries_.end(); }
+        const_iterator begin() const { return entries_.begin(); }
+        const_iterator end() const { return entries_.end(); }
+        const_iterator cbegin() const { return entries_.cbegin(); }
+        const_iterator cend() const { return entries_.cend(); }
+
+    private:
+        /// Room made for the first headers at once, enough for most requests and responses.
+        static constexpr size_t initial_capacity = 8;
+
+        size_t index_of(std::string_view key) const
+        {
+            size_t i = 0;
+            for (; i < entries_.size(); i++)
+            {
+                if (detail::ci_equal(entries_[i].first, key))
+                    break;
+            }
+            return i;
+        }
+
+        std::pmr::vector<value_type> entries_;
+    };
+} // namespace crow
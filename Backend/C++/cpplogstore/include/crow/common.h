@@ -0,0 +1,413 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include <iostream>
+#include "crow/utility.h"
+
+namespace crow
+{
+    const char cr = '\r';
+    const char lf = '\n';
+    const std::string crlf("\r\n");
+
+    enum class HTTPMethod : char
+    {
+#ifndef DELETE
+        DELETE = 0,
+        GET,
+        HEAD,
+        POST,
+        PUT,
+
+        CONNECT,
+        OPTIONS,
+        TRACE,
+
+        PATCH,
+        PURGE,
+
+        COPY,
+        LOCK,
+        MKCOL,
+        MOVE,
+        PROPFIND,
+        PROPPATCH,
+        SEARCH,
+        UNLOCK,
+        BIND,
+        REBIND,
+        UNBIND,
+        ACL,
+
+        REPORT,
+        MKACTIVITY,
+        CHECKOUT,
+        MERGE,
+
+        MSEARCH,
+        NOTIFY,
+        SUBSCRIBE,
+        UNSUBSCRIBE,
+
+        MKCALENDAR,
+
+        LINK,
+        UNLINK,
+
+        SOURCE,
+#endif
+
+        Delete = 0,
+        Get,
+        Head,
+        Post,
+        Put,
+
+        Connect,
+        Options,
+        Trace,
+
+        Patch,
+        Purge,
+
+        Copy,
+        Lock,
+        MkCol,
+        Move,
+        Propfind,
+        Proppatch,
+        Search,
+        Unlock,
+        Bind,
+        Rebind,
+        Unbind,
+        Acl,
+
+        Report,
+        MkActivity,
+        Checkout,
+        Merge,
+
+        MSearch,
+        Notify,
+        Subscribe,
+        Unsubscribe,
+
+        MkCalendar,
+
+        Link,
+        Unlink,
+
+        Source,
+
+
+        InternalMethodCount,
+        // should not add an item below this line: used for array count
+    };
+
+    constexpr const char* method_strings[] =
+      {
+        "DELETE",
+        "GET",
+        "HEAD",
+        "POST",
+        "PUT",
+
+        "CONNECT",
+        "OPTIONS",
+        "TRACE",
+
+        "PATCH",
+        "PURGE",
+
+        "COPY",
+        "LOCK",
+        "MKCOL",
+        "MOVE",
+        "PROPFIND",
+        "PROPPATCH",
+        "SEARCH",
+        "UNLOCK",
+        "BIND",
+        "REBIND",
+        "UNBIND",
+        "ACL",
+
+        "REPORT",
+        "MKACTIVITY",
+        "CHECKOUT",
+        "MERGE",
+
+        "M-SEARCH",
+        "NOTIFY",
+        "SUBSCRIBE",
+        "UNSUBSCRIBE",
+
+        "MKCALENDAR",
+
+        "LINK",
+        "UNLINK",
+
+        "SOURCE"};
+
+
+    inline std::string method_name(HTTPMethod method)
+    {
+        if (CROW_LIKELY(method < HTTPMethod::InternalMethodCount))
+        {
+            return method_strings[(unsigned char)method];
+        }
+        return "invalid";
+    }
+
+    // clang-format off
+
+    enum status
+    {
+        CONTINUE                      = 100,
+        SWITCHING_PROTOCOLS           = 101,
+
+        OK                            = 200,
+        CREATED                       = 201,
+        ACCEPTED                      = 202,
+        NON_AUTHORITATIVE_INFORMATION = 203,
+        NO_CONTENT                    = 204,
+        RESET_CONTENT                 = 205,
+        PARTIAL_CONTENT               = 206,
+
+        MULTIPLE_CHOICES              = 300,
+        MOVED_PERMANENTLY             = 301,
+        FOUND                         = 302,
+        SEE_OTHER                     = 303,
+        NOT_MODIFIED                  = 304,
+        TEMPORARY_REDIRECT            = 307,
+        PERMANENT_REDIRECT            = 308,
+
+        BAD_REQUEST                   = 400,
+        UNAUTHORIZED                  = 401,
+        FORBIDDEN                     = 403,
+        NOT_FOUND                     = 404,
+        METHOD_NOT_ALLOWED            = 405,
+        NOT_ACCEPTABLE                = 406,
+        PROXY_AUTHENTICATION_REQUIRED = 407,
+        CONFLICT                      = 409,
+        GONE                          = 410,
+        PAYLOAD_TOO_LARGE             = 413,
+        UNSUPPORTED_MEDIA_TYPE        = 415,
+        RANGE_NOT_SATISFIABLE         = 416,
+        EXPECTATION_FAILED            = 417,
+        PRECONDITION_REQUIRED         = 428,
+        TOO_MANY_REQUESTS             = 429,
+        UNAVAILABLE_FOR_LEGAL_REASONS = 451,
+
+        INTERNAL_SERVER_ERROR         = 500,
+        NOT_IMPLEMENTED               = 501,
+        BAD_GATEWAY                   = 502,
+        SERVICE_UNAVAILABLE           = 503,
+        GATEWAY_TIMEOUT               = 504,
+        VARIANT_ALSO_NEGOTIATES       = 506
+    };
+
+    namespace detail
+    {
+        /// The status line sent for a code, CRLF included, or an empty view for a code missing from \ref status.
+        inline std::string_view status_line(int code)
+        {
+            // TODO(EDev): HTTP version in status codes should be dynamic
+            static constexpr auto lines = [] {
+                std::array<std::string_view, 600> l{};
+                l[CONTINUE]                      = "HTTP/1.1 100 Continue\r\n";
+                l[SWITCHING_PROTOCOLS]           = "HTTP/1.1 101 Switching Protocols\r\n";
+
+                l[OK]                            = "HTTP/1.1 200 OK\r\n";
+                l[CREATED]                       = "HTTP/1.1 201 Created\r\n";
+                l[ACCEPTED]                      = "HTTP/1.1 202 Accepted\r\n";
+                l[NON_AUTHORITATIVE_INFORMATION] = "HTTP/1.1 203 Non-Authoritative Information\r\n";
+                l[NO_CONTENT]                    = "HTTP/1.1 204 No Content\r\n";
+                l[RESET_CONTENT]                 = "HTTP/1.1 205 Reset Content\r\n";
+                l[PARTIAL_CONTENT]               = "HTTP/1.1 206 Partial Content\r\n";
+
+                l[MULTIPLE_CHOICES]              = "HTTP/1.1 300 Multiple Choices\r\n";
+                l[MOVED_PERMANENTLY]             = "HTTP/1.1 301 Moved Permanently\r\n";
+                l[FOUND]                         = "HTTP/1.1 302 Found\r\n";
+                l[SEE_OTHER]                     = "HTTP/1.1 303 See Other\r\n";
+                l[NOT_MODIFIED]                  = "HTTP/1.1 304 Not Modified\r\n";
+                l[TEMPORARY_REDIRECT]            = "HTTP/1.1 307 Temporary Redirect\r\n";
+                l[PERMANENT_REDIRECT]            = "HTTP/1.1 308 Permanent Redirect\r\n";
+
+                l[BAD_REQUEST]                   = "HTTP/1.1 400 Bad Request\r\n";
+                l[UNAUTHORIZED]                  = "HTTP/1.1 401 Unauthorized\r\n";
+                l[FORBIDDEN]                     = "HTTP/1.1 403 Forbidden\r\n";
+                l[NOT_FOUND]                     = "HTTP/1.1 404 Not Found\r\n";
+                l[METHOD_NOT_ALLOWED]            = "HTTP/1.1 405 Method Not Allowed\r\n";
+                l[NOT_ACCEPTABLE]                = "HTTP/1.1 406 Not Acceptable\r\n";
+                l[PROXY_AUTHENTICATION_REQUIRED] = "HTTP/1.1 407 Proxy Authentication Required\r\n";
+                l[CONFLICT]                      = "HTTP/1.1 409 Conflict\r\n";
+                l[GONE]                          = "HTTP/1.1 410 Gone\r\n";
+                l[PAYLOAD_TOO_LARGE]             = "HTTP/1.1 413 Payload Too Large\r\n";
+                l[UNSUPPORTED_MEDIA_TYPE]        = "HTTP/1.1 415 Unsupported Media Type\r\n";
+                l[RANGE_NOT_SATISFIABLE]         = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+                l[EXPECTATION_FAILED]            = "HTTP/1.1 417 Expectation Failed\r\n";
+                l[PRECONDITION_REQUIRED]         = "HTTP/1.1 428 Precondition Required\r\n";
+                l[TOO_MANY_REQUESTS]             = "HTTP/1.1 429 Too Many Requests\r\n";
+                l[UNAVAILABLE_FOR_LEGAL_REASONS] = "HTTP/1.1 451 Unavailable For Legal Reasons\r\n";
+
+                l[INTERNAL_SERVER_ERROR]         = "HTTP/1.1 500 Internal Server Error\r\n";
+                l[NOT_IMPLEMENTED]               = "HTTP/1.1 501 Not Implemented\r\n";
+                l[BAD_GATEWAY]                   = "HTTP/1.1 502 Bad Gateway\r\n";
+                l[SERVICE_UNAVAILABLE]           = "HTTP/1.1 503 Service Unavailable\r\n";
+                l[GATEWAY_TIMEOUT]               = "HTTP/1.1 504 Gateway Timeout\r\n";
+                l[VARIANT_ALSO_NEGOTIATES]       = "HTTP/1.1 506 Variant Also Negotiates\r\n";
+                return l;
+            }();
+            return code >= 0 && code < static_cast<int>(lines.size()) ? lines[code] : std::string_view();
+        }
+    } // namespace detail
+
+    // clang-format on
+
+    enum class ParamType : char
+    {
+        INT,
+        UINT,
+        DOUBLE,
+        STRING,
+        PATH,
+
+        MAX
+    };
+
+    /// @cond SKIP
+    struct routing_params
+    {
+        std::vector<int64_t> int_params;
+        std::vector<uint64_t> uint_params;
+        std::vector<double> double_params;
+        std::vector<std::string> string_params;
+
+        void debug_print() const
+        {
+            std::cerr << "routing_params" << std::endl;
+            for (auto i : int_params)
+                std::cerr << i << ", ";
+            std::cerr << std::endl;
+            for (auto i : uint_params)
+                std::cerr << i << ", ";
+            std::cerr << std::endl;
+            for (auto i : double_params)
+                std::cerr << i << ", ";
+            std::cerr << std::endl;
+            for (auto& i : string_params)
+                std::cerr << i << ", ";
+            std::cerr << std::endl;
+        }
+
+        template<typename T>
+        T get(unsigned) const;
+    };
+
+    template<>
+    inline int64_t routing_params::get<int64_t>(unsigned index) const
+    {
+        return int_params[index];
+    }
+
+    template<>
+    inline uint64_t routing_params::get<uint64_t>(unsigned index) const
+    {
+        return uint_params[index];
+    }
+
+    template<>
+    inline double routing_params::get<double>(unsigned index) const
+    {
+        return double_params[index];
+    }
+
+    template<>
+    inline std::string routing_params::get<std::string>(unsigned index) const
+    {
+        return string_params[index];
+    }
+    /// @endcond
+
+    struct routing_handle_result
+    {
+        uint16_t rule_index;
+        std::vector<uint16_t> blueprint_indices;
+        routing_params r_params;
+        HTTPMethod method;
+
+        routing_handle_result() {}
+
+        routing_handle_result(uint16_t rule_index_, std::vector<uint16_t> blueprint_indices_, routing_params r_params_):
+          rule_index(rule_index_),
+          blueprint_indices(blueprint_indices_),
+          r_params(r_params_) {}
+
+        routing_handle_result(uint16_t rule_index_, std::vector<uint16_t> blueprint_indices_, routing_params r_params_, HTTPMethod method_):
+          rule_index(rule_index_),
+          blueprint_indices(blueprint_indices_),
+          r_params(r_params_),
+          method(method_) {}
+    };
+} // namespace crow
+
+// clang-format off
+#ifndef CROW_MSVC_WORKAROUND
+constexpr crow::HTTPMethod method_from_string(const char* str)
+{
+    return crow::black_magic::is_equ_p(str, "GET", 3)    ? crow::HTTPMethod::Get :
+           crow::black_magic::is_equ_p(str, "DELETE", 6) ? crow::HTTPMethod::Delete :
+           crow::black_magic::is_equ_p(str, "HEAD", 4)   ? crow::HTTPMethod::Head :
+           crow::black_magic::is_equ_p(str, "POST", 4)   ? crow::HTTPMethod::Post :
+           crow::black_magic::is_equ_p(str, "PUT", 3)    ? crow::HTTPMethod::Put :
+
+           crow::black_magic::is_equ_p(str, "OPTIONS", 7) ? crow::HTTPMethod::Options :
+           crow::black_magic::is_equ_p(str, "CONNECT", 7) ? crow::HTTPMethod::Connect :
+           crow::black_magic::is_equ_p(str, "TRACE", 5)   ? crow::HTTPMethod::Trace :
+
+           crow::black_magic::is_equ_p(str, "PATCH", 5)     ? crow::HTTPMethod::Patch :
+           crow::black_magic::is_equ_p(str, "PURGE", 5)     ? crow::HTTPMethod::Purge :
+           crow::black_magic::is_equ_p(str, "COPY", 4)      ? crow::HTTPMethod::Copy :
+           crow::black_magic::is_equ_p(str, "LOCK", 4)      ? crow::HTTPMethod::Lock :
+           crow::black_magic::is_equ_p(str, "MKCOL", 5)     ? crow::HTTPMethod::MkCol :
+           crow::black_magic::is_equ_p(str, "MOVE", 4)      ? crow::HTTPMethod::Move :
+           crow::black_magic::is_equ_p(str, "PROPFIND", 8)  ? crow::HTTPMethod::Propfind :
+           crow::black_magic::is_equ_p(str, "PROPPATCH", 9) ? crow::HTTPMethod::Proppatch :
+           crow::black_magic::is_equ_p(str, "SEARCH", 6)    ? crow::HTTPMethod::Search :
+           crow::black_magic::is_equ_p(str, "UNLOCK", 6)    ? crow::HTTPMethod::Unlock :
+           crow::black_magic::is_equ_p(str, "BIND", 4)      ? crow::HTTPMethod::Bind :
+           crow::black_magic::is_equ_p(str, "REBIND", 6)    ? crow::HTTPMethod::Rebind :
+           crow::black_magic::is_equ_p(str, "UNBIND", 6)    ? crow::HTTPMethod::Unbind :
+           crow::black_magic::is_equ_p(str, "ACL", 3)       ? crow::HTTPMethod::Acl :
+
+           crow::black_magic::is_equ_p(str, "REPORT", 6)      ? crow::HTTPMethod::Report :
+           crow::black_magic::is_equ_p(str, "MKACTIVITY", 10) ? crow::HTTPMethod::MkActivity :
+           crow::black_magic::is_equ_p(str, "CHECKOUT", 8)    ? crow::HTTPMethod::Checkout :
+           crow::black_magic::is_equ_p(str, "MERGE", 5)       ? crow::HTTPMethod::Merge :
+
+           crow::black_magic::is_equ_p(str, "MSEARCH", 7)      ? crow::HTTPMethod::MSearch :
+           crow::black_magic::is_equ_p(str, "NOTIFY", 6)       ? crow::HTTPMethod::Notify :
+           crow::black_magic::is_equ_p(str, "SUBSCRIBE", 9)    ? crow::HTTPMethod::Subscribe :
+           crow::black_magic::is_equ_p(str, "UNSUBSCRIBE", 11) ? crow::HTTPMethod::Unsubscribe :
+
+           crow::black_magic::is_equ_p(str, "MKCALENDAR", 10) ? crow::HTTPMethod::MkCalendar :
+
+           crow::black_magic::is_equ_p(str, "LINK", 4)   ? crow::HTTPMethod::Link :
+           crow::black_magic::is_equ_p(str, "UNLINK", 6) ? crow::HTTPMethod::Unlink :
+
+           crow::black_magic::is_equ_p(str, "SOURCE", 6) ? crow::HTTPMethod::Source :
+                                                           throw std::runtime_error("invalid http method");
+}
+
+constexpr crow::HTTPMethod operator"" _method(const char* str, size_t /*len*/)
+{
+    return method_from_string( str );
+}
+#endif
+// clang-format on
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#include "crow/common.h"
+#include "crow/http_parser_merged.h"
+#include "crow/utility.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// Scanning for the bytes that end a URL or a header value, 32 or 16 bytes at a time where the CPU allows.
+        namespace scan
+        {
+            /// The first byte in [p, end) that can't be part of a header value: a control character other than tab.
+            inline const char* value_end(const char* p, const char* end)
+            {
+#if defined(__AVX2__)
+                const __m256i space = _mm256_set1_epi8(0x20), minus_one = _mm256_set1_epi8(-1);
+                const __m256i tab = _mm256_set1_epi8(0x09), del = _mm256_set1_epi8(0x7f);
+                for (; end - p >= 32; p += 32)
+                {
+                    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    // Signed compares: bytes from 0x80 up are negative, and allowed.
+                    __m256i ctl = _mm256_and_si256(_mm256_cmpgt_epi8(space, c), _mm256_cmpgt_epi8(c, minus_one));
+                    ctl = _mm256_andnot_si256(_mm256_cmpeq_epi8(c, tab), ctl);
+                    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(ctl, _mm256_cmpeq_epi8(c, del))));
+                    if (mask)
+                        return p + __builtin_ctz(mask);
+                }
+#elif defined(__SSE4_2__)
+                // 0x00-0x08, 0x0a-0x1f and 0x7f.
+                const __m128i ranges = _mm_setr_epi8(0x00, 0x08, 0x0a, 0x1f, 0x7f, 0x7f, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+                for (; end - p >= 16; p += 16)
+                {
+                    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    int i = _mm_cmpestri(ranges, 6, c, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+                    if (i != 16)
+                        return p + i;
+                }
+#endif
+                for (; p != end; p++)
+                {
+                    unsigned char c = static_cast<unsigned char>(*p);
+                    if ((c < 0x20 && c != 0x09) || c == 0x7f)
+                        break;
+                }
+                return p;
+            }
+
+            /// The first byte in [p, end) that ends a URL, or that only http_parser knows how to handle: a space or control
+            /// character, '#', or a byte from 0x7f up.
+            inline const char* url_end(const char* p, const char* end)
+            {
+#if defined(__AVX2__)
+                const __m256i bang = _mm256_set1_epi8(0x21), hash = _mm256_set1_epi8('#'), del = _mm256_set1_epi8(0x7f);
+                for (; end - p >= 32; p += 32)
+                {
+                    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+                    // Signed compare: bytes from 0x80 up are negative, so they stop the scan too.
+                    __m256i stop = _mm256_or_si256(_mm256_cmpgt_epi8(bang, c), _mm256_cmpeq_epi8(c, hash));
+                    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(stop, _mm256_cmpeq_epi8(c, del))));
+                    if (mask)
+                        return p + __builtin_ctz(mask);
+                }
+#elif defined(__SSE4_2__)
+                // 0x00-0x20, '#' and 0x7f-0xff.
+                const __m128i ranges = _mm_setr_epi8(0x00, 0x20, '#', '#', 0x7f, static_cast<char>(0xff), 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+                for (; end - p >= 16; p += 16)
+                {
+                    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                    int i = _mm_cmpestri(ranges, 6, c, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+                    if (i != 16)
+                        return p + i;
+                }
+#endif
+                for (; p != end; p++)
+                {
+                    unsigned char c = static_cast<unsigned char>(*p);
+                    if (c <= 0x20 || c >= 0x7f || c == '#')
+                        break;
+                }
+                return p;
+            }
+
+            /// Whether a byte may be part of a header name (a token in RFC 9110).
+            inline bool is_token(char ch)
+            {
+                static constexpr auto table = [] {
+                    struct
+                    {
+                        bool allowed[256] = {};
+                    } t;
+                    for (int c = '0'; c <= '9'; c++)
+                        t.allowed[c] = true;
+                    for (int c = 'a'; c <= 'z'; c++)
+                        t.allowed[c] = t.allowed[c - 'a' + 'A'] = true;
+                    for (char c : std::string_view("!#$%&'*+-.^_`|~"))
+                        t.allowed[static_cast<unsigned char>(c)] = true;
+                    return t;
+                }();
+                return table.allowed[static_cast<unsigned char>(ch)];
+            }
+        } // namespace scan
+
+        /// The request line and headers of a request, as views into the bytes they were parsed from.
+        struct request_head
+        {
+            static constexpr size_t max_headers = 64;
+
+            struct header
+            {
+                std::string_view name;
+                std::string_view value;
+            };
+
+            HTTPMethod method;
+            std::string_view url;
+            unsigned char http_major, http_minor;
+            header headers[max_headers];
+            size_t header_count;
+            /// `F_CONNECTION_KEEP_ALIVE` and `F_CONNECTION_CLOSE`, as http_parser would set them.
+            unsigned flags;
+            uint64_t content_length;
+            /// Bytes from the start of the request line to the end of the empty line after the headers.
+            size_t size;
+        };
+
+        /// Parse the request line and headers at the start of [begin, end) in one go.
+
+        ///
+        /// Only requests that are complete in the buffer and that http_parser would take exactly as written are
+        /// accepted: a known method, an origin-form URL without fragment, HTTP/1.0 or 1.1, CRLF line endings, non-empty
+        /// header values, no line folding, a plain Content-Length, and neither Transfer-Encoding nor an Upgrade. Anything
+        /// else returns false without looking further, and is left to http_parser, which also reports any errors.
+        inline bool parse_request_head(const char* begin, const char* end, request_head& head)
+        {
+            const char* p = begin;
+
+            static constexpr struct
+            {
+                std::string_view name;
+                HTTPMethod method;
+            } methods[] = {
+              {"GET ", HTTPMethod::Get},
+              {"POST ", HTTPMethod::Post},
+              {"PUT ", HTTPMethod::Put},
+              {"DELETE ", HTTPMethod::Delete},
+              {"PATCH ", HTTPMethod::Patch},
+              {"HEAD ", HTTPMethod::Head},
+              {"OPTIONS ", HTTPMethod::Options},
+            };
+            bool known = false;
+            for (auto& m : methods)
+            {
+                if (static_cast<size_t>(end - p) > m.name.size() && std::memcmp(p, m.name.data(), m.name.size()) == 0)
+                {
+                    head.method = m.method;
+                    p += m.name.size();
+                    known = true;
+                    break;
+                }
+            }
+            if (!known || *p != '/')
+                return false;
+
+            const char* url_end = scan::url_end(p, end);
+            if (end - url_end < 11 || *url_end != ' ')
+                return false;
+            head.url = std::string_view(p, url_end - p);
+            p = url_end + 1;
+            if (std::memcmp(p, "HTTP/1.", 7) != 0 || (p[7] != '0' && p[7] != '1') || p[8] != '\r' || p[9] != '\n')
+                return false;
+            head.http_major = 1;
+            head.http_minor = p[7] - '0';
+            p += 10;
+
+            head.header_count = 0;
+            head.flags = 0;
+            head.content_length = 0;
+            bool has_content_length = false;
+            for (;;)
+            {
+                if (end - p < 2)
+                    return false;
+                if (p[0] == '\r')
+                {
+                    if (p[1] != '\n')
+                        return false;
+                    p += 2;
+                    break;
+                }
+                if (head.header_count == request_head::max_headers)
+                    return false;
+
+                const char* name = p;
+                while (p != end && scan::is_token(*p))
+                    p++;
+                if (p == end || *p != ':' || p == name)
+                    return false;
+                std::string_view field(name, p - name);
+                p++;
+                while (p != end && (*p == ' ' || *p == '\t'))
+                    p++;
+                const char* value = p;
+                p = scan::value_end(p, end);
+                if (end - p < 2 || p[0] != '\r' || p[1] != '\n' || p == value)
+                    return false;
+                std::string_view field_value(value, p - value);
+                p += 2;
+
+                // The headers http_parser looks at itself.
+                if (utility::string_equals(field, "content-length"))
+                {
+                    if (has_content_length || field_value.size() > 18)
+                        return false;
+                    for (char c : field_value)
+                    {
+                        if (c < '0' || c > '9')
+                            return false;
+                        head.content_length = head.content_length * 10 + (c - '0');
+                    }
+                    has_content_length = true;
+                }
+                else if (utility::string_equals(field, "connection"))
+                {
+                    if (utility::string_equals(field_value, "keep-alive"))
+                        head.flags |= F_CONNECTION_KEEP_ALIVE;
+                    else if (utility::string_equals(field_value, "close"))
+                        head.flags |= F_CONNECTION_CLOSE;
+                    else
+                        return false;
+                }
+                else if (utility::string_equals(field, "transfer-encoding") || utility::string_equals(field, "upgrade") ||
+                         utility::string_equals(field, "proxy-connection"))
+                    return false;
+
+                head.headers[head.header_count++] = {field, field_value};
+            }
+
+            if (static_cast<size_t>(p - begin) > CROW_HTTP_MAX_HEADER_SIZE)
+                return false;
+            head.size = p - begin;
+            return true;
+        }
+    } // namespace detail
+} // namespace crow
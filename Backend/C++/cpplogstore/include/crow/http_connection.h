@@ -0,0 +1,1071 @@
+#pragma once
+
+#include "crow/settings.h"
+
+#ifdef CROW_USE_BOOST
+#include <boost/asio.hpp>
+#else
+#ifndef ASIO_STANDALONE
+#define ASIO_STANDALONE
+#endif
+#include <asio.hpp>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "crow/http_parser_merged.h"
+#include "crow/common.h"
+#include "crow/compression.h"
+#include "crow/connection_pool.h"
+#include "crow/file_cache.h"
+#include "crow/http2.h"
+#include "crow/http_date.h"
+#include "crow/http_response.h"
+#include "crow/load_balancer.h"
+#include "crow/logging.h"
+#include "crow/middleware.h"
+#include "crow/middleware_context.h"
+#include "crow/parser.h"
+#include "crow/request_arena.h"
+#include "crow/socket_adaptors.h"
+#include "crow/task_timer.h"
+#include "crow/utility.h"
+
+namespace crow
+{
+#ifdef CROW_USE_BOOST
+    namespace asio = boost::asio;
+    using error_code = boost::system::error_code;
+#else
+    using error_code = asio::error_code;
+#endif
+    using tcp = asio::ip::tcp;
+
+#ifdef CROW_ENABLE_DEBUG
+    static std::atomic<int> connectionCount;
+#endif
+
+    namespace detail
+    {
+        /// A response waiting in a connection's outbound queue, with everything it needs to outlive the request.
+        struct outbound_message
+        {
+            std::string head;                   ///< Status line and headers.
+            std::string body;                   ///< Moved out of the response, never copied.
+            std::shared_ptr<const std::string> shared_body; ///< Sent instead of `body`, e.g. a cached static asset.
+            std::size_t body_written = 0;       ///< Bytes of the body already sent.
+            std::shared_ptr<const cached_file> file; ///< Static file to send after the head.
+            uint64_t file_offset = 0;           ///< Next byte of the file to send.
+            uint64_t file_end = 0;              ///< One past the last byte of the file to send.
+            std::vector<char> chunk;            ///< Holds the file chunk being written, where sendfile can't be used.
+            bool head_written = false;
+            bool close_connection = false;
+
+            const std::string& payload() const
+            {
+                return shared_body ? *shared_body : body;
+            }
+        };
+
+        enum class byte_range
+        {
+            whole,
+            partial,
+            unsatisfiable
+        };
+
+        /// Parse a `Range` header of the form `bytes=first-last`, `bytes=first-` or `bytes=-suffix` for a `size` byte file.
+
+        ///
+        /// On `partial`, the part to send is [begin, end). Anything else, multiple ranges included, means the whole file.
+        inline byte_range parse_byte_range(std::string_view header, uint64_t size, uint64_t& begin, uint64_t& end)
+        {
+            constexpr std::string_view unit = "bytes=";
+            if (header.compare(0, unit.size(), unit) != 0 || header.find(',') != std::string_view::npos)
+                return byte_range::whole;
+            size_t dash = header.find('-', unit.size());
+            if (dash == std::string_view::npos)
+                return byte_range::whole;
+
+            auto number = [&header](size_t from, size_t to, uint64_t& value) {
+                auto result = std::from_chars(header.data() + from, header.data() + to, value);
+                return from < to && result.ec == std::errc() && result.ptr == header.data() + to;
+            };
+            uint64_t first = 0, last = 0;
+            bool has_first = number(unit.size(), dash, first);
+            bool has_last = number(dash + 1, header.size(), last);
+            if ((!has_first && dash != unit.size()) || (!has_last && dash + 1 != header.size()))
+                return byte_range::whole;
+
+            if (has_first)
+            {
+                if (has_last && last < first)
+                    return byte_range::whole;
+                if (first >= size)
+                    return byte_range::unsatisfiable;
+                begin = first;
+                end = has_last ? std::min(last, size - 1) + 1 : size;
+            }
+            else if (has_last)
+            {
+                if (last == 0 || size == 0)
+                    return byte_range::unsatisfiable;
+                begin = size - std::min(last, size);
+                end = size;
+            }
+            else
+                return byte_range::whole;
+            return byte_range::partial;
+        }
+    } // namespace detail
+
+    /// An HTTP connection.
+    template<typename Adaptor, typename Handler, typename... Middlewares>
+    class Connection : public std::enable_shared_from_this<Connection<Adaptor, Handler, Middlewares...>>
+    {
+        friend struct crow::response;
+
+    public:
+        Connection(
+          asio::io_context& io_context,
+          Handler* handler,
+          const std::string& server_name,
+          std::tuple<Middlewares...>* middlewares,
+          detail::task_timer& task_timer,
+          typename Adaptor::context* adaptor_ctx,
+          detail::io_context_load& load):
+          adaptor_(io_context, adaptor_ctx),
+          io_context_(io_context),
+          adaptor_ctx_(adaptor_ctx),
+          handler_(handler),
+          parser_(this, &arena_),
+          req_(parser_.req),
+          server_name_(server_name),
+          middlewares_(middlewares),
+          task_timer_(task_timer),
+          res_stream_threshold_(handler->stream_threshold()),
+          load_(load)
+        {
+#ifdef CROW_ENABLE_DEBUG
+            connectionCount++;
+            CROW_LOG_DEBUG << "Connection (" << this << ") allocated, total: " << connectionCount;
+#endif
+        }
+
+        ~Connection()
+        {
+            release_load();
+#ifdef CROW_ENABLE_DEBUG
+            connectionCount--;
+            CROW_LOG_DEBUG << "Connection (" << this << ") freed, total: " << connectionCount;
+#endif
+        }
+
+        /// Give back the load of a connection that is done and forget its client, keeping the memory it has allocated.
+
+        ///
+        /// Called by the \ref detail::connection_pool once nothing refers to the connection anymore, instead of
+        /// destroying it. Request and response bodies are released, buffers and queues keep their capacity.
+        void recycle()
+        {
+            release_load();
+            adaptor_.close();
+            adaptor_ = Adaptor(io_context_, adaptor_ctx_);
+            read_buffer_.reset(); // This may not be the io thread, so it doesn't go back to that thread's pool.
+            parser_.reset();
+            arena_.reset();
+            routing_handle_result_.reset();
+            res = response();
+            close_connection_ = false;
+            head_.clear();
+            outbound_.clear();
+            write_buffers_.clear();
+            write_body_bytes_ = 0;
+            write_file_bytes_ = 0;
+            write_batched_ = 0;
+            file_range_begin_ = 0;
+            file_range_end_ = 0;
+            static_body_.reset();
+            unparsed_begin_ = 0;
+            unparsed_end_ = 0;
+            outbound_bytes_ = 0;
+            writing_ = false;
+            read_paused_ = false;
+            task_id_ = 0;
+            need_to_call_after_handlers_ = false;
+            need_to_start_read_after_complete_ = false;
+            add_keep_alive_ = false;
+            first_read_ = true;
+            upgrade_to_http2_ = false;
+            ctx_ = detail::context<Middlewares...>();
+        }
+
+        /// Start counting a recycled connection again, for the client it is about to accept.
+        void reuse()
+        {
+            counted_ = true;
+        }
+
+        /// The TCP socket on top of which the connection is established.
+        decltype(std::declval<Adaptor>().raw_socket())& socket()
+        {
+            return adaptor_.raw_socket();
+        }
+
+        void start()
+        {
+            auto self = this->shared_from_this();
+            adaptor_.start([self](const error_code& ec) {
+                if (!ec)
+                {
+                    self->start_deadline();
+                    self->parser_.clear();
+
+                    self->do_read();
+                }
+                else
+                {
+                    CROW_LOG_ERROR << "Could not start adaptor: " << ec.message();
+                }
+            });
+        }
+
+        void handle_url()
+        {
+            routing_handle_result_ = handler_->handle_initial(req_, res);
+            // if no route is found for the request method, return the response without parsing or processing anything further.
+            if (!routing_handle_result_->rule_index)
+            {
+                parser_.done();
+                need_to_call_after_handlers_ = true;
+                complete_request();
+            }
+        }
+
+        void handle_header()
+        {
+            // HTTP 1.1 Expect: 100-continue
+            if (req_.http_ver_major == 1 && req_.http_ver_minor == 1 && get_header_value(req_.headers, "expect") == "100-continue")
+            {
+                static std::string expect_100_continue = "HTTP/1.1 100 Continue\r\n\r\n";
+                detail::outbound_message message;
+                message.head = expect_100_continue;
+                outbound_bytes_ += message.head.size();
+                outbound_.push_back(std::move(message));
+                do_write();
+            }
+        }
+
+        void handle()
+        {
+            // TODO(EDev): cancel_deadline_timer should be looked into, it might be a good idea to add it to handle_url() and then restart the timer once everything passes
+            cancel_deadline_timer();
+            bool is_invalid_request = false;
+            add_keep_alive_ = false;
+            in_flight_ = true;
+            load_.in_flight++;
+
+            // Create context
+            ctx_ = detail::context<Middlewares...>();
+            req_.middleware_context = static_cast<void*>(&ctx_);
+            req_.middleware_container = static_cast<void*>(middlewares_);
+            req_.io_context = &adaptor_.get_io_context();
+
+            req_.remote_ip_address = adaptor_.address();
+
+            add_keep_alive_ = req_.keep_alive;
+            close_connection_ = req_.close_connection;
+
+            if (req_.check_version(1, 1)) // HTTP/1.1
+            {
+                if (!req_.headers.count("host"))
+                {
+                    is_invalid_request = true;
+                    res = response(400);
+                }
+                else if (req_.upgrade)
+                {
+                    // h2 or h2c headers
+                    if (req_.get_header_value("upgrade").find("h2")==0)
+                    {
+                        // Not flagged as an upgrade by the parser; h2c is handled below
+                    }
+                    else
+                    {
+
+                        detail::middleware_call_helper<detail::middleware_call_criteria_only_global,
+                                                       0, decltype(ctx_), decltype(*middlewares_)>({}, *middlewares_, req_, res, ctx_);
+                        close_connection_ = true;
+                        handler_->handle_upgrade(req_, res, std::move(adaptor_));
+                        return;
+                    }
+                }
+                else if (req_.get_header_value("upgrade") == "h2c" && req_.headers.count("http2-settings") && !handler_->ssl_used() && outbound_.empty())
+                {
+                    // Cleartext HTTP/2 (RFC 7540 section 3.2), once any earlier responses are out of the way. The body
+                    // has been read as HTTP/1.1; parsing stops here and the rest goes to the HTTP/2 connection.
+                    // h2 needs TLS with ALPN, so such requests are simply answered over HTTP/1.1.
+                    upgrade_to_http2_ = true;
+                    parser_.pause();
+                    return;
+                }
+            }
+
+            CROW_LOG_INFO << "Request: " << utility::lexical_cast<std::string>(adaptor_.remote_endpoint()) << " " << this << " HTTP/" << (char)(req_.http_ver_major + '0') << "." << (char)(req_.http_ver_minor + '0') << ' ' << method_name(req_.method) << " " << req_.url;
+
+
+            need_to_call_after_handlers_ = false;
+            if (!is_invalid_request)
+            {
+                res.complete_request_handler_ = nullptr;
+                auto self = this->shared_from_this();
+                res.is_alive_helper_ = [self]() -> bool {
+                    return self->adaptor_.is_open();
+                };
+
+                detail::middleware_call_helper<detail::middleware_call_criteria_only_global,
+                                               0, decltype(ctx_), decltype(*middlewares_)>({}, *middlewares_, req_, res, ctx_);
+
+                if (!res.completed_)
+                {
+                    res.complete_request_handler_ = [self] {
+                        self->complete_request();
+                    };
+                    need_to_call_after_handlers_ = true;
+                    handler_->handle(req_, res, routing_handle_result_);
+                    if (add_keep_alive_)
+                        res.set_header("connection", "Keep-Alive");
+                    // The parser holds this request until it is answered, so pipelined ones have to wait.
+                    if (need_to_call_after_handlers_)
+                        parser_.pause();
+                }
+                else
+                {
+                    complete_request();
+                }
+            }
+            else
+            {
+                complete_request();
+            }
+        }
+
+        /// Call the after handle middleware and send the write the response to the connection.
+        void complete_request()
+        {
+            CROW_LOG_INFO << "Response: " << this << ' ' << req_.raw_url << ' ' << res.code << ' ' << close_connection_;
+            res.is_alive_helper_ = nullptr;
+            if (in_flight_)
+            {
+                in_flight_ = false;
+                load_.in_flight--;
+            }
+
+            if (need_to_call_after_handlers_)
+            {
+                need_to_call_after_handlers_ = false;
+
+                // call all after_handler of middlewares
+                detail::after_handlers_call_helper<
+                  detail::middleware_call_criteria_only_global,
+                  (static_cast<int>(sizeof...(Middlewares)) - 1),
+                  decltype(ctx_),
+                  decltype(*middlewares_)>({}, *middlewares_, ctx_, req_, res);
+            }
+#ifdef CROW_ENABLE_COMPRESSION
+            compression::compress_response(*handler_, req_, res);
+#endif
+
+            if (res.is_static_type())
+            {
+                if (res.file_info.asset && !req_.headers.count("range"))
+                    use_static_asset();
+                else
+                    apply_static_range();
+            }
+
+            prepare_head();
+            queue_response();
+        }
+
+    private:
+        /// Write the status line and headers of `res` into `head_`, one append after another.
+
+        ///
+        /// `head_` is the string of an earlier response's head, handed back by finish_message() once it was sent, so it
+        /// rarely needs to grow. The head then goes out with the body as two buffers of one write.
+        void prepare_head()
+        {
+            res.complete_request_handler_ = nullptr;
+            res.is_alive_helper_ = nullptr;
+
+            if (!adaptor_.is_open())
+            {
+                //CROW_LOG_DEBUG << this << " delete (socket is closed) " << is_reading << ' ' << is_writing;
+                //delete this;
+                return;
+            }
+
+            std::string_view status = detail::status_line(res.code);
+            if (status.empty())
+            {
+                CROW_LOG_WARNING << this << " status code "
+                                 << "(" << res.code << ")"
+                                 << " not defined, returning 500 instead";
+                res.code = 500;
+                status = detail::status_line(res.code);
+            }
+
+            if (res.code >= 400 && res.body.empty())
+                res.body = status.substr(9);
+
+            head_.clear();
+            head_.append(status);
+
+            bool has_content_length = res.manual_length_header, has_server = false, has_date = false;
+            for (auto& kv : res.headers)
+            {
+                head_.append(kv.first).append(": ", 2).append(kv.second).append("\r\n", 2);
+                // The only names that can match are the headers Crow adds itself.
+                switch (kv.first.size())
+                {
+                    case 4: has_date = has_date || utility::string_equals(kv.first, "date"); break;
+                    case 6: has_server = has_server || utility::string_equals(kv.first, "server"); break;
+                    case 14: has_content_length = has_content_length || utility::string_equals(kv.first, "content-length"); break;
+                }
+            }
+
+            if (!has_content_length)
+            {
+                char length[20];
+                auto end = std::to_chars(length, length + sizeof(length), res.body.size()).ptr;
+                head_.append("Content-Length: ", 16).append(length, end - length).append("\r\n", 2);
+            }
+            if (!has_server)
+                head_.append("Server: ", 8).append(server_name_).append("\r\n", 2);
+            if (!has_date)
+                head_.append("Date: ", 6).append(detail::http_date::now()).append("\r\n", 2);
+            if (add_keep_alive_)
+                head_.append("Connection: Keep-Alive\r\n", 24);
+
+            head_.append("\r\n", 2);
+        }
+
+        /// Answer from the in-memory copy of a small static file, in the best encoding the client accepts.
+        void use_static_asset()
+        {
+            const auto& asset = *res.file_info.asset;
+            const auto& variant = asset.pick(req_.get_header_value("accept-encoding"));
+            res.set_header("ETag", variant.etag);
+            if (asset.has_encodings())
+                res.set_header("Vary", "Accept-Encoding");
+
+            const std::string& if_none_match = req_.get_header_value("if-none-match");
+            if (!if_none_match.empty() && (if_none_match == "*" || if_none_match.find(variant.etag) != std::string::npos))
+            {
+                res.code = 304;
+                res.headers.erase("Content-Length");
+                res.manual_length_header = true;
+                res.file_info = response::static_file_info{};
+                return;
+            }
+
+            if (!variant.encoding.empty())
+                res.set_header("Content-Encoding", variant.encoding);
+            res.set_header("Content-Length", variant.content_length);
+            static_body_ = variant.data;
+        }
+
+        /// Answer a `Range` request for a static file with 206 and just that part, or 416 if it starts past the end.
+        void apply_static_range()
+        {
+            uint64_t size = res.file_info.statbuf.st_size;
+            file_range_begin_ = 0;
+            file_range_end_ = size;
+
+            // An If-Range can't be validated without an ETag, so it gets the whole file, as RFC 9110 allows.
+            const std::string& range = req_.get_header_value("range");
+            if (range.empty() || res.code != 200 || req_.headers.count("if-range"))
+                return;
+
+            switch (detail::parse_byte_range(range, size, file_range_begin_, file_range_end_))
+            {
+                case detail::byte_range::partial:
+                    res.code = 206;
+                    res.set_header("Content-Length", std::to_string(file_range_end_ - file_range_begin_));
+                    res.set_header("Content-Range", "bytes " + std::to_string(file_range_begin_) + '-' + std::to_string(file_range_end_ - 1) + '/' + std::to_string(size));
+                    break;
+                case detail::byte_range::unsatisfiable:
+                    res.code = 416;
+                    res.headers.erase("Content-Length");
+                    res.headers.erase("Content-Type");
+                    res.set_header("Content-Range", "bytes */" + std::to_string(size));
+                    res.file_info = response::static_file_info{};
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        /// Move the response into the outbound queue and get ready for the next request.
+        void queue_response()
+        {
+            if (adaptor_.is_open())
+            {
+                detail::outbound_message message;
+                message.head.swap(head_);
+                if (res.is_static_type())
+                {
+                    if (req_.method != HTTPMethod::Head)
+                    {
+                        if (static_body_)
+                            message.shared_body = std::move(static_body_);
+                        else
+                        {
+                            message.file = res.file_info.file;
+                            message.file_offset = file_range_begin_;
+                            message.file_end = file_range_end_;
+                            if (!Adaptor::can_sendfile)
+                                message.chunk.resize(write_chunk_size);
+                        }
+                    }
+                }
+                else
+                    message.body.swap(res.body);
+                message.close_connection = close_connection_;
+
+                outbound_bytes_ += message.head.size() + message.payload().size();
+                outbound_.push_back(std::move(message));
+            }
+
+            res.clear();
+            static_body_.reset();
+            parser_.clear();
+            arena_.release();
+            if (outbound_bytes_ > CROW_OUTBOUND_HIGH_WATERMARK)
+                parser_.pause();
+
+            do_write();
+            if (need_to_start_read_after_complete_)
+            {
+                need_to_start_read_after_complete_ = false;
+                resume_reading();
+            }
+        }
+
+        /// Parse the next pipelined request, or read more, unless this client has too many unsent responses queued already.
+
+        ///
+        /// Reading resumes once the queue drains below the low watermark (see \ref on_write()).
+        void resume_reading()
+        {
+            start_deadline();
+            if (outbound_bytes_ > CROW_OUTBOUND_HIGH_WATERMARK)
+            {
+                CROW_LOG_DEBUG << this << " paused reading, " << outbound_bytes_ << " bytes queued";
+                read_paused_ = true;
+                return;
+            }
+            if (unparsed_begin_ < unparsed_end_)
+                parse_buffered(unparsed_begin_, unparsed_end_);
+            else
+                do_read();
+        }
+
+        /// Read the next bytes from the client.
+
+        ///
+        /// On a plain socket this only waits until it is readable, and a read buffer is borrowed from the io thread's
+        /// pool once data is there. TLS keeps its own buffers, and readiness of the socket says nothing about what it
+        /// has decrypted already, so there the buffer is held during the read.
+        void do_read()
+        {
+            auto self = this->shared_from_this();
+            if constexpr (Adaptor::can_sendfile)
+            {
+                release_read_buffer();
+                arena_.trim();
+                adaptor_.raw_socket().async_wait(asio::socket_base::wait_read, [self](const error_code& ec) {
+                    if (!ec)
+                        self->read_available();
+                    else
+                        self->close_after_read();
+                });
+            }
+            else
+            {
+                if (!read_buffer_)
+                    read_buffer_ = detail::read_buffer_pool::local().acquire();
+                adaptor_.socket().async_read_some(
+                  asio::buffer(*read_buffer_),
+                  [self](const error_code& ec, std::size_t bytes_transferred) {
+                      if (!ec)
+                          self->parse_buffered(0, bytes_transferred);
+                      else
+                          self->close_after_read();
+                  });
+            }
+        }
+
+        /// Read what a readable plain socket has, into a buffer borrowed for it.
+        void read_available()
+        {
+            auto& socket = adaptor_.raw_socket();
+            error_code ec;
+            if (!socket.non_blocking())
+                socket.non_blocking(true, ec);
+            read_buffer_ = detail::read_buffer_pool::local().acquire();
+            std::size_t bytes_transferred = ec ? 0 : socket.read_some(asio::buffer(*read_buffer_), ec);
+            if (ec == asio::error::would_block || ec == asio::error::try_again)
+                do_read();
+            else if (ec)
+                close_after_read();
+            else
+                parse_buffered(0, bytes_transferred);
+        }
+
+        void release_read_buffer()
+        {
+            if (read_buffer_)
+                detail::read_buffer_pool::local().release(std::move(read_buffer_));
+        }
+
+        /// Stop reading after the client closed its side, a read failed or a request couldn't be parsed.
+
+        ///
+        /// Responses to the requests before that still go out: the connection is closed after the last of them, or
+        /// right away if there is none.
+        void close_after_read()
+        {
+            release_read_buffer();
+            parser_.done();
+            adaptor_.shutdown_read();
+            need_to_start_read_after_complete_ = false;
+            CROW_LOG_DEBUG << this << " from read(1) with description: \"" << http_errno_description(static_cast<http_errno>(parser_.http_errno)) << '\"';
+            if (!adaptor_.is_open())
+            {
+                cancel_deadline_timer();
+                return;
+            }
+            if (in_flight_)
+            {
+                // complete_request() queues the last response.
+                close_connection_ = true;
+                return;
+            }
+            if (!outbound_.empty())
+            {
+                outbound_.back().close_connection = true;
+                return;
+            }
+            cancel_deadline_timer();
+            adaptor_.close();
+        }
+
+        /// Parse the bytes in [begin, end) of the read buffer, which may hold several pipelined requests.
+
+        ///
+        /// The parser stops early after a request whose response is still pending or overfills the outbound queue. The
+        /// bytes it didn't get to stay in the buffer and are parsed by \ref resume_reading() before anything new is read.
+        void parse_buffered(size_t begin, size_t end)
+        {
+            if (first_read_)
+            {
+                first_read_ = false;
+                static const std::string request_line = "PRI * HTTP/2.0\r\n";
+                if (end - begin >= request_line.size() && std::equal(request_line.begin(), request_line.end(), read_buffer_->data() + begin) && !handler_->ssl_used())
+                {
+                    start_http2(begin, end);
+                    return;
+                }
+            }
+
+            size_t parsed = 0;
+            auto started = std::chrono::steady_clock::now();
+            bool ret = parser_.feed(read_buffer_->data() + begin, end - begin, parsed);
+            load_.busy_ns.fetch_add(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count(),
+              std::memory_order_relaxed);
+            unparsed_begin_ = begin + parsed;
+            unparsed_end_ = end;
+            if (upgrade_to_http2_)
+            {
+                start_http2(unparsed_begin_, unparsed_end_);
+                return;
+            }
+            // The parser copied what it needs, so the buffer only has to stay while pipelined bytes wait in it.
+            if (unparsed_begin_ == unparsed_end_)
+                release_read_buffer();
+
+            if (!ret || !adaptor_.is_open())
+            {
+                close_after_read();
+            }
+            else if (close_connection_)
+            {
+                cancel_deadline_timer();
+                parser_.done();
+                // adaptor will close after write
+            }
+            else if (!need_to_call_after_handlers_)
+            {
+                resume_reading();
+            }
+            else
+            {
+                // res will be completed later by user
+                need_to_start_read_after_complete_ = true;
+            }
+        }
+
+        /// Hand the socket over to an HTTP/2 connection, with the bytes in [begin, end) of the read buffer still to be parsed.
+
+        ///
+        /// This connection goes away once the read that led here returns. On an upgrade, the request that asked for it
+        /// becomes stream 1.
+        void start_http2(size_t begin, size_t end)
+        {
+            cancel_deadline_timer();
+            auto connection = std::make_shared<http2::Connection<Adaptor, Handler, Middlewares...>>(
+              std::move(adaptor_), handler_, server_name_, middlewares_, task_timer_, load_);
+            if (upgrade_to_http2_)
+            {
+                std::string settings = req_.get_header_value("http2-settings");
+                connection->start_upgraded(std::move(req_), settings, read_buffer_->data() + begin, end - begin);
+            }
+            else
+                connection->start(read_buffer_->data() + begin, end - begin);
+            release_read_buffer();
+        }
+
+        /// Start writing the front of the outbound queue, unless a write is already in progress.
+
+        ///
+        /// Every write is asynchronous. A body below the stream threshold goes out with its head in one write, together
+        /// with small responses queued behind it. Larger bodies follow the head in chunks, one write each, straight from
+        /// the queued message. Static files go through sendfile on plain TCP, and are read into a chunk per write
+        /// otherwise (TLS).
+        void do_write()
+        {
+            while (!writing_ && !outbound_.empty())
+            {
+                auto& message = outbound_.front();
+                write_buffers_.clear();
+                write_body_bytes_ = 0;
+                write_file_bytes_ = 0;
+                write_batched_ = 0;
+
+                if (!message.head_written)
+                    write_buffers_.emplace_back(message.head.data(), message.head.size());
+                if (message.file)
+                {
+                    if (message.file_offset < message.file_end)
+                    {
+#ifdef CROW_HAS_SENDFILE
+                        if (Adaptor::can_sendfile && message.head_written)
+                        {
+                            send_file(message);
+                            continue;
+                        }
+                        if (!Adaptor::can_sendfile)
+#endif
+                        {
+                            write_file_bytes_ = message.file->read(message.chunk.data(), CROW_MIN(message.chunk.size(), message.file_end - message.file_offset), message.file_offset);
+                            if (write_file_bytes_ == 0)
+                            {
+                                abort_writes("static file shrank while being sent");
+                                return;
+                            }
+                            write_buffers_.emplace_back(message.chunk.data(), write_file_bytes_);
+                        }
+                    }
+                }
+                else if (message.body_written < message.payload().size())
+                {
+                    const std::string& body = message.payload();
+                    size_t remaining = body.size() - message.body_written;
+                    write_body_bytes_ = body.size() < res_stream_threshold_ ? remaining : CROW_MIN(write_chunk_size, remaining);
+                    write_buffers_.emplace_back(body.data() + message.body_written, write_body_bytes_);
+                }
+                if (is_small(message))
+                    batch_small_messages();
+
+                if (write_buffers_.empty())
+                {
+                    finish_message();
+                    continue;
+                }
+
+                writing_ = true;
+                auto self = this->shared_from_this();
+                asio::async_write(
+                  adaptor_.socket(), write_buffers_,
+                  [self](const error_code& ec, std::size_t /*bytes_transferred*/) {
+                      self->on_write(ec);
+                  });
+            }
+        }
+
+        /// A response that goes out whole in a single write, head and body together.
+        bool is_small(const detail::outbound_message& message) const
+        {
+            return !message.head_written && !message.file && message.payload().size() < res_stream_threshold_;
+        }
+
+        /// Add the small responses queued behind the front one to the same write.
+
+        ///
+        /// Pipelined requests with short answers then cost one syscall (a single writev) between them, up to
+        /// `max_batched_messages` more responses or `max_batched_bytes` more bytes.
+        void batch_small_messages()
+        {
+            write_batched_ = 0;
+            size_t bytes = 0;
+            for (auto it = outbound_.begin(); !it->close_connection && ++it != outbound_.end();)
+            {
+                size_t size = it->head.size() + it->payload().size();
+                if (!is_small(*it) || write_batched_ == max_batched_messages || bytes + size > max_batched_bytes)
+                    break;
+                write_buffers_.emplace_back(it->head.data(), it->head.size());
+                if (!it->payload().empty())
+                    write_buffers_.emplace_back(it->payload().data(), it->payload().size());
+                bytes += size;
+                write_batched_++;
+            }
+        }
+
+#ifdef CROW_HAS_SENDFILE
+        /// Have the kernel send the next part of a static file from the page cache.
+
+        ///
+        /// Sends at most `sendfile_chunk_size` bytes before letting other connections on this io thread run, and
+        /// waits for the socket to drain when it is full.
+        void send_file(detail::outbound_message& message)
+        {
+            auto& socket = adaptor_.raw_socket();
+            error_code ec;
+            if (!socket.native_non_blocking())
+                socket.native_non_blocking(true, ec);
+            if (ec)
+            {
+                abort_writes(ec.message());
+                return;
+            }
+
+            off_t offset = static_cast<off_t>(message.file_offset);
+            size_t count = CROW_MIN(static_cast<uint64_t>(sendfile_chunk_size), message.file_end - message.file_offset);
+            ssize_t sent = ::sendfile(socket.native_handle(), message.file->fd, &offset, count);
+            if (sent < 0 && errno == EINTR)
+                return;
+            if (sent <= 0 && !(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)))
+            {
+                abort_writes(sent == 0 ? std::string("static file shrank while being sent") : std::string(strerror(errno)));
+                return;
+            }
+
+            writing_ = true;
+            auto self = this->shared_from_this();
+            if (sent > 0)
+            {
+                message.file_offset += sent;
+                if (!in_flight_)
+                    start_deadline();
+                asio::post(adaptor_.get_io_context(), [self] {
+                    self->writing_ = false;
+                    self->do_write();
+                });
+            }
+            else
+            {
+                socket.async_wait(asio::socket_base::wait_write, [self](const error_code& ec) {
+                    self->writing_ = false;
+                    if (ec)
+                        self->abort_writes(ec.message());
+                    else
+                        self->do_write();
+                });
+            }
+        }
+#endif
+
+        /// Drop everything queued and close the connection; the client can't get a complete response any more.
+        void abort_writes(const std::string& reason)
+        {
+            CROW_LOG_DEBUG << this << " from write(2): " << reason;
+            outbound_.clear();
+            outbound_bytes_ = 0;
+            cancel_deadline_timer();
+            adaptor_.shutdown_readwrite();
+            adaptor_.close();
+        }
+
+        void on_write(const error_code& ec)
+        {
+            writing_ = false;
+            if (ec)
+            {
+                abort_writes(ec.message());
+                return;
+            }
+
+            auto& message = outbound_.front();
+            if (!message.head_written)
+            {
+                message.head_written = true;
+                outbound_bytes_ -= message.head.size();
+            }
+            message.body_written += write_body_bytes_;
+            message.file_offset += write_file_bytes_;
+            outbound_bytes_ -= write_body_bytes_;
+            // Batched responses went out whole; do_write() pops them along with the front one.
+            for (size_t i = 1; i <= write_batched_; i++)
+            {
+                auto& batched = outbound_[i];
+                batched.head_written = true;
+                batched.body_written = batched.payload().size();
+                outbound_bytes_ -= batched.head.size() + batched.body_written;
+            }
+            write_batched_ = 0;
+
+            // The client is keeping up, so the idle timeout starts over (unless a handler is still working on a request).
+            if (!in_flight_)
+                start_deadline();
+
+            if (read_paused_ && outbound_bytes_ <= CROW_OUTBOUND_LOW_WATERMARK)
+            {
+                CROW_LOG_DEBUG << this << " resumed reading, " << outbound_bytes_ << " bytes queued";
+                read_paused_ = false;
+                resume_reading();
+            }
+            do_write();
+        }
+
+        /// The front message has been sent in full.
+        void finish_message()
+        {
+            bool close = outbound_.front().close_connection;
+            // Keep the string of the head for the next response's head.
+            if (head_.capacity() <= outbound_.front().head.capacity())
+                head_.swap(outbound_.front().head);
+            outbound_.pop_front();
+            if (close)
+            {
+                outbound_.clear();
+                outbound_bytes_ = 0;
+                cancel_deadline_timer();
+                adaptor_.shutdown_write();
+                adaptor_.close();
+                CROW_LOG_DEBUG << this << " from write(1)";
+            }
+        }
+
+        /// The connection counts towards its io thread's load from the accept until it is destroyed or recycled.
+        void release_load()
+        {
+            if (!counted_)
+                return;
+            counted_ = false;
+            if (in_flight_)
+            {
+                load_.in_flight--;
+                in_flight_ = false;
+            }
+            load_.connections--;
+        }
+
+        void cancel_deadline_timer()
+        {
+            CROW_LOG_DEBUG << this << " timer cancelled: " << &task_timer_ << ' ' << task_id_;
+            task_timer_.cancel(task_id_);
+        }
+
+        void start_deadline(/*int timeout = 5*/)
+        {
+            cancel_deadline_timer();
+
+            auto self = this->shared_from_this();
+            task_id_ = task_timer_.schedule([self] {
+                if (!self->adaptor_.is_open())
+                {
+                    return;
+                }
+                self->adaptor_.shutdown_readwrite();
+                self->adaptor_.close();
+            });
+            CROW_LOG_DEBUG << this << " timer added: " << &task_timer_ << ' ' << task_id_;
+        }
+
+    private:
+        Adaptor adaptor_;
+        asio::io_context& io_context_;
+        typename Adaptor::context* adaptor_ctx_;
+        Handler* handler_;
+
+        /// Borrowed from the io thread's pool while there are received bytes to parse, see \ref do_read().
+        std::unique_ptr<detail::read_buffer_pool::buffer> read_buffer_;
+
+        /// Holds the headers of the request being parsed, see \ref detail::request_arena.
+        detail::request_arena arena_;
+        HTTPParser<Connection> parser_;
+        std::unique_ptr<routing_handle_result> routing_handle_result_;
+        request& req_;
+        response res;
+
+        bool close_connection_ = false;
+
+        const std::string& server_name_;
+        /// Head of the response being completed, before it moves into the outbound queue.
+        std::string head_;
+
+        /// Largest piece of a large body or static file sent in one write.
+        static constexpr size_t write_chunk_size = 16384;
+        /// Largest piece of a static file sent in one go with sendfile.
+        static constexpr size_t sendfile_chunk_size = 1 << 20;
+        /// Most small responses sent in one write behind the front one, and their total size.
+        static constexpr size_t max_batched_messages = 32;
+        static constexpr size_t max_batched_bytes = 65536;
+
+        std::deque<detail::outbound_message> outbound_;
+        std::vector<asio::const_buffer> write_buffers_;
+        size_t write_body_bytes_{};
+        size_t write_file_bytes_{};
+        size_t write_batched_{};
+        uint64_t file_range_begin_{};
+        uint64_t file_range_end_{};
+        std::shared_ptr<const std::string> static_body_;
+        size_t unparsed_begin_{};
+        size_t unparsed_end_{};
+        size_t outbound_bytes_{};
+        bool writing_{};
+        bool read_paused_{};
+
+        detail::task_timer::identifier_type task_id_{};
+
+        bool need_to_call_after_handlers_{};
+        bool need_to_start_read_after_complete_{};
+        bool add_keep_alive_{};
+        bool in_flight_{};
+        bool counted_{true};
+        bool first_read_{true};
+        bool upgrade_to_http2_{};
+
+        std::tuple<Middlewares...>* middlewares_;
+        detail::context<Middlewares...> ctx_;
+
+        detail::task_timer& task_timer_;
+
+        size_t res_stream_threshold_;
+
+        detail::io_context_load& load_;
+    };
+
+} // namespace crow
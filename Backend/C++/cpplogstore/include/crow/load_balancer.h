@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    /// How a server picks the io thread that serves a new connection.
+
+    ///
+    /// Only used with a single acceptor. With `app.reuse_port()` the kernel places connections instead.
+    enum class placement_strategy
+    {
+        /// The io thread with the fewest open connections (default).
+        least_connections,
+        /// The less loaded of two io threads chosen at random, judged by the requests they are handling right now.
+        power_of_two_choices,
+        /// The less busy of two io threads chosen at random, judged by their recent busy time (an exponentially
+        /// weighted moving average). Sampling two rather than taking the minimum keeps a burst of connections from all
+        /// landing on the one thread that looked idle at the last sample.
+        busy_time
+    };
+
+    namespace detail
+    {
+        /// Load of one io thread, updated by its connections and read by the acceptor.
+        struct io_context_load
+        {
+            /// Open connections, including idle keep-alive ones.
+            std::atomic<unsigned int> connections{0};
+            /// Requests that have been parsed but not yet answered.
+            std::atomic<unsigned int> in_flight{0};
+            /// Nanoseconds spent parsing and running handlers since the last sample.
+            std::atomic<uint64_t> busy_ns{0};
+            /// Smoothed busy_ns per sample. Only touched by the acceptor's thread.
+            double busy_ewma = 0;
+        };
+
+        /// Picks an io thread for each accepted connection. Not thread safe; lives on the acceptor's thread.
+        class load_balancer
+        {
+        public:
+            /// Weight of the newest sample in the busy time average.
+            static constexpr double ewma_alpha = 0.25;
+
+            load_balancer(std::vector<io_context_load>& loads, placement_strategy strategy):
+              loads_(loads), strategy_(strategy)
+            {}
+
+            void strategy(placement_strategy strategy)
+            {
+                strategy_ = strategy;
+            }
+
+            placement_strategy strategy() const
+            {
+                return strategy_;
+            }
+
+            uint16_t pick()
+            {
+                if (loads_.size() < 2)
+                    return 0;
+
+                switch (strategy_)
+                {
+                    case placement_strategy::power_of_two_choices:
+                        return pick_power_of_two();
+                    case placement_strategy::busy_time:
+                        return pick_least_busy();
+                    default:
+                        return pick_least_connections();
+                }
+            }
+
+            /// Fold the busy time gathered since the last call into each average. Call at a fixed interval.
+            void sample()
+            {
+                for (auto& load : loads_)
+                {
+                    double busy = static_cast<double>(load.busy_ns.exchange(0, std::memory_order_relaxed));
+                    load.busy_ewma += ewma_alpha * (busy - load.busy_ewma);
+                }
+            }
+
+        private:
+            uint16_t pick_least_connections()
+            {
+                uint16_t min_idx = 0;
+                // size_t is used here to avoid the security issue https://codeql.github.com/codeql-query-help/cpp/cpp-comparison-with-wider-type/
+                // even though the max value of this can be only uint16_t as concurrency is uint16_t.
+                for (size_t i = 1; i < loads_.size() && loads_[min_idx].connections > 0; i++)
+                // No need to check other io_services if the current one has no connections
+                {
+                    if (loads_[i].connections < loads_[min_idx].connections)
+                        min_idx = i;
+                }
+                return min_idx;
+            }
+
+            uint16_t pick_power_of_two()
+            {
+                size_t a, b;
+                two_choices(a, b);
+                return less_loaded(a, b) ? a : b;
+            }
+
+            uint16_t pick_least_busy()
+            {
+                size_t a, b;
+                two_choices(a, b);
+                if (loads_[a].busy_ewma != loads_[b].busy_ewma)
+                    return loads_[a].busy_ewma < loads_[b].busy_ewma ? a : b;
+                return less_loaded(a, b) ? a : b;
+            }
+
+            /// Two distinct io threads, uniformly at random.
+            void two_choices(size_t& a, size_t& b)
+            {
+                a = std::uniform_int_distribution<size_t>(0, loads_.size() - 1)(rng_);
+                b = std::uniform_int_distribution<size_t>(0, loads_.size() - 2)(rng_);
+                if (b >= a)
+                    b++;
+            }
+
+            /// Fewer requests in flight, or as many and fewer connections.
+            bool less_loaded(size_t a, size_t b) const
+            {
+                unsigned int in_flight_a = loads_[a].in_flight.load(std::memory_order_relaxed);
+                unsigned int in_flight_b = loads_[b].in_flight.load(std::memory_order_relaxed);
+                if (in_flight_a != in_flight_b)
+                    return in_flight_a < in_flight_b;
+                return loads_[a].connections.load(std::memory_order_relaxed) <= loads_[b].connections.load(std::memory_order_relaxed);
+            }
+
+        private:
+            std::vector<io_context_load>& loads_;
+            placement_strategy strategy_;
+            std::minstd_rand rng_{std::random_device{}()};
+        };
+    } // namespace detail
+} // namespace crow
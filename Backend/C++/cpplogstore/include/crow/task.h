@@ -0,0 +1,268 @@
+#pragma once
+
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "crow/settings.h"
+#include "crow/http_response.h"
+#include "crow/logging.h"
+#include "crow/executor.h"
+
+#ifdef CROW_CAN_USE_COROUTINES
+#include <coroutine>
+#endif
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+#ifdef CROW_CAN_USE_COROUTINES
+    template<typename T>
+    class task;
+
+    namespace detail
+    {
+        struct task_promise_base
+        {
+            struct final_awaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+                {
+                    auto continuation = finished.promise().continuation_;
+                    if (continuation)
+                        return continuation;
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            final_awaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void unhandled_exception() noexcept
+            {
+                exception_ = std::current_exception();
+            }
+
+            void rethrow_if_exception()
+            {
+                if (exception_)
+                    std::rethrow_exception(exception_);
+            }
+
+            std::coroutine_handle<> continuation_;
+            std::exception_ptr exception_;
+        };
+
+        template<typename T>
+        struct task_promise : task_promise_base
+        {
+            task<T> get_return_object() noexcept;
+
+            template<typename U>
+            void return_value(U&& value)
+            {
+                value_.emplace(std::forward<U>(value));
+            }
+
+            T result()
+            {
+                rethrow_if_exception();
+                return std::move(*value_);
+            }
+
+            std::optional<T> value_;
+        };
+
+        template<>
+        struct task_promise<void> : task_promise_base
+        {
+            task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void result()
+            {
+                rethrow_if_exception();
+            }
+        };
+    } // namespace detail
+
+    /// A lazily started coroutine that produces a `T`.
+
+    ///
+    /// Route handlers may return a `crow::task<R>` (where `R` is anything a handler could return directly, usually
+    /// `crow::response`). Crow starts the coroutine and sends `R` once it `co_return`s, so the handler can `co_await`
+    /// slow operations (e.g. \ref executor::async()) without blocking the io thread and without touching `res.end()`.
+    ///
+    /// Handler parameters are copied into the coroutine, except for the `const crow::request&`, which stays valid until
+    /// the response is sent. Take URL parameters by value, not by reference.
+    ///
+    /// A task can itself be `co_await`ed from another task.
+    template<typename T = void>
+    class [[nodiscard]] task
+    {
+    public:
+        using promise_type = detail::task_promise<T>;
+        using handle_type = std::coroutine_handle<promise_type>;
+
+        explicit task(handle_type handle) noexcept:
+          handle_(handle)
+        {}
+
+        task(task&& other) noexcept:
+          handle_(std::exchange(other.handle_, nullptr))
+        {}
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+            return *this;
+        }
+
+        task(const task&) = delete;
+        task& operator=(const task&) = delete;
+
+        ~task()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        bool await_ready() const noexcept
+        {
+            return !handle_ || handle_.done();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            handle_.promise().continuation_ = awaiting;
+            return handle_;
+        }
+
+        T await_resume()
+        {
+            return handle_.promise().result();
+        }
+
+    private:
+        handle_type handle_;
+    };
+
+    namespace detail
+    {
+        template<typename T>
+        task<T> task_promise<T>::get_return_object() noexcept
+        {
+            return task<T>(std::coroutine_handle<task_promise<T>>::from_promise(*this));
+        }
+
+        inline task<void> task_promise<void>::get_return_object() noexcept
+        {
+            return task<void>(std::coroutine_handle<task_promise<void>>::from_promise(*this));
+        }
+
+        /// A fire-and-forget coroutine that frees itself when it finishes.
+        struct detached_task
+        {
+            struct promise_type
+            {
+                detached_task get_return_object() noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never initial_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                void return_void() noexcept {}
+
+                void unhandled_exception() noexcept
+                {
+                    std::terminate();
+                }
+            };
+        };
+
+        template<typename T>
+        struct is_task : std::false_type
+        {};
+
+        template<typename T>
+        struct is_task<task<T>> : std::true_type
+        {};
+
+        template<typename T>
+        detached_task respond_with(response& res, task<T> handler_task)
+        {
+            static_assert(!std::is_void<T>::value, "Handler task cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
+            try
+            {
+                res = response(co_await std::move(handler_task));
+            }
+            catch (const executor_full&)
+            {
+                res = response(503);
+            }
+            catch (const std::exception& e)
+            {
+                CROW_LOG_ERROR << "An uncaught exception occurred in a handler task: " << e.what();
+                res = response(500);
+            }
+            catch (...)
+            {
+                CROW_LOG_ERROR << "An uncaught exception occurred in a handler task. The type was unknown so no information was available.";
+                res = response(500);
+            }
+            res.end();
+        }
+    } // namespace detail
+#endif
+
+    namespace detail
+    {
+        /// Turn whatever a handler returned into the response and send it.
+        template<typename T>
+        void handler_result(response& res, T&& value)
+        {
+#ifdef CROW_CAN_USE_COROUTINES
+            if constexpr (is_task<typename std::decay<T>::type>::value)
+            {
+                respond_with(res, std::move(value));
+                return;
+            }
+            else
+#endif
+            {
+                res = response(std::forward<T>(value));
+                res.end();
+            }
+        }
+    } // namespace detail
+} // namespace crow
@@ -0,0 +1,6 @@
+#pragma once
+
+namespace crow
+{
+    constexpr const char VERSION[] = "master";
+}
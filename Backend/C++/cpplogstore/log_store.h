@@ -0,0 +1,612 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "include/crow.h"
+
+// Open-addressing hash map from list id to the offset of its latest record.
+//
+// Linear probing over a power-of-two table of (id, offset) pairs. Id 0 marks
+// an empty slot and ~0 a deleted one, so neither can be used as a key; the
+// store hands out ids starting at 1. The table doubles once it is 70% full,
+// counting deleted slots, which are dropped on every rehash.
+class OffsetIndex
+{
+public:
+    explicit OffsetIndex(size_t capacity = 1024)
+    {
+        size_t size = 16;
+        while (size < capacity)
+            size <<= 1;
+        slots_.assign(size, slot{});
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    std::optional<uint64_t> find(uint64_t id) const
+    {
+        for (size_t i = home(id);; i = (i + 1) & mask())
+        {
+            const slot& s = slots_[i];
+            if (s.id == id)
+                return s.offset;
+            if (s.id == empty)
+                return std::nullopt;
+        }
+    }
+
+    /// Insert or overwrite. Returns the previous offset, if there was one.
+    std::optional<uint64_t> put(uint64_t id, uint64_t offset)
+    {
+        if ((size_ + deleted_ + 1) * 10 > slots_.size() * 7)
+            rehash(size_ * 4 >= slots_.size() ? slots_.size() * 2 : slots_.size());
+
+        slot* reuse = nullptr;
+        for (size_t i = home(id);; i = (i + 1) & mask())
+        {
+            slot& s = slots_[i];
+            if (s.id == id)
+            {
+                return std::exchange(s.offset, offset);
+            }
+            if (s.id == deleted && !reuse)
+                reuse = &s;
+            if (s.id == empty)
+            {
+                if (reuse)
+                    deleted_--;
+                else
+                    reuse = &s;
+                *reuse = slot{id, offset};
+                size_++;
+                return std::nullopt;
+            }
+        }
+    }
+
+    /// Returns the removed offset, if the id was present.
+    std::optional<uint64_t> erase(uint64_t id)
+    {
+        for (size_t i = home(id);; i = (i + 1) & mask())
+        {
+            slot& s = slots_[i];
+            if (s.id == id)
+            {
+                s.id = deleted;
+                size_--;
+                deleted_++;
+                return s.offset;
+            }
+            if (s.id == empty)
+                return std::nullopt;
+        }
+    }
+
+    template<typename Func>
+    void for_each(Func&& f) const
+    {
+        for (const slot& s : slots_)
+            if (s.id != empty && s.id != deleted)
+                f(s.id, s.offset);
+    }
+
+private:
+    static constexpr uint64_t empty = 0;
+    static constexpr uint64_t deleted = ~uint64_t(0);
+
+    struct slot
+    {
+        uint64_t id = empty;
+        uint64_t offset = 0;
+    };
+
+    size_t mask() const
+    {
+        return slots_.size() - 1;
+    }
+
+    size_t home(uint64_t id) const
+    {
+        // Fibonacci hashing: ids are sequential, so spread them over the table.
+        return static_cast<size_t>((id * 0x9E3779B97F4A7C15ull) >> 32) & mask();
+    }
+
+    void rehash(size_t capacity)
+    {
+        std::vector<slot> old(capacity, slot{});
+        old.swap(slots_);
+        size_ = 0;
+        deleted_ = 0;
+        for (const slot& s : old)
+            if (s.id != empty && s.id != deleted)
+                put(s.id, s.offset);
+    }
+
+    std::vector<slot> slots_;
+    size_t size_ = 0;
+    size_t deleted_ = 0;
+};
+
+// Lists kept in a single append-only, memory-mapped file.
+//
+// Every change appends a record; nothing is ever rewritten in place:
+//
+//   u32 crc     CRC-32 of everything after this field
+//   u32 length  length of the value
+//   u8  type    1 = put, 2 = delete
+//   u64 id
+//   ... value bytes
+//
+// Integers are stored in host byte order. The file is grown in large steps
+// with ftruncate and mapped whole, so an append is a memcpy into the mapping
+// and a read is a lookup in the in-memory index plus a copy out of the page
+// cache, without a system call.
+//
+// On open the file is scanned from the start and the index rebuilt from the
+// records. The scan stops at the first record that does not check out (a write
+// torn by a crash, or the zero-filled space past the end) and the file is cut
+// there. When more than half the file is overwritten or deleted records it is
+// compacted before use.
+//
+// The store assumes it is the file's only writer. It holds an exclusive flock
+// on <path>.lock while open, so a second process fails to start instead of
+// appending to the same file. The lock is on a file of its own because
+// compaction replaces the data file.
+//
+// Writes are applied in batches by commit(): the records are appended, the
+// file is flushed once with fdatasync and only then are the new records made
+// visible. Anything a caller has seen committed is therefore on disk and is
+// found again by the scan after a crash. See wal.h for how concurrent writers
+// are gathered into one batch.
+class LogStore
+{
+public:
+    explicit LogStore(std::string path):
+      path_(std::move(path))
+    {
+        lock_file();
+        open_file();
+        recover();
+        if (end_ > min_capacity && live_bytes_ * 2 < end_)
+        {
+            compact();
+            recover();
+        }
+        CROW_LOG_INFO << "Log store " << path_ << ": " << index_.size() << " lists, " << end_ << " bytes";
+    }
+
+    ~LogStore()
+    {
+        unmap();
+        if (fd_ >= 0)
+            ::close(fd_);
+        if (lock_fd_ >= 0)
+            ::close(lock_fd_);
+    }
+
+    LogStore(const LogStore&) = delete;
+    LogStore& operator=(const LogStore&) = delete;
+
+    /// One write for commit().
+    struct change
+    {
+        enum kind_t
+        {
+            insert,
+            update,
+            erase
+        };
+
+        kind_t kind = insert;
+        uint64_t id = 0;    ///< The list to update or erase. Set to the new id by an insert.
+        std::string list;   ///< The new value, for insert and update.
+        bool found = false; ///< Set once committed: false if an update or erase found no such list.
+    };
+
+    /// Apply a batch of writes in order and flush them with a single fdatasync,
+    /// then make them visible to readers.
+    ///
+    /// Nothing of the batch becomes visible, and nothing is left for recovery to
+    /// find, if the flush fails; the error is thrown to the caller.
+    void commit(const std::vector<change*>& batch)
+    {
+        std::lock_guard<std::mutex> write_lock(write_mutex_);
+
+        // Where each id touched by the batch will point once published, or
+        // nullopt if it was erased. Later writes must see earlier ones.
+        std::unordered_map<uint64_t, std::optional<uint64_t>> staged;
+        auto exists = [&](uint64_t id) {
+            auto it = staged.find(id);
+            // Only writers change the index, so it can be read without mutex_ here.
+            return it != staged.end() ? it->second.has_value() : index_.find(id).has_value();
+        };
+
+        uint64_t next_id = next_id_;
+        uint64_t tail = end_;
+        try
+        {
+            for (change* c : batch)
+            {
+                switch (c->kind)
+                {
+                    case change::insert:
+                        c->id = next_id++;
+                        c->found = true;
+                        staged[c->id] = tail;
+                        tail = append(put_record, c->id, c->list, tail);
+                        break;
+                    case change::update:
+                        c->found = exists(c->id);
+                        if (c->found)
+                        {
+                            staged[c->id] = tail;
+                            tail = append(put_record, c->id, c->list, tail);
+                        }
+                        break;
+                    case change::erase:
+                        c->found = exists(c->id);
+                        if (c->found)
+                        {
+                            staged[c->id] = std::nullopt;
+                            tail = append(delete_record, c->id, {}, tail);
+                        }
+                        break;
+                }
+            }
+            if (tail != end_ && ::fdatasync(fd_) != 0)
+                throw_errno("fdatasync", path_);
+        }
+        catch (...)
+        {
+            std::memset(base_ + end_, 0, tail - end_);
+            throw;
+        }
+
+        next_id_ = next_id;
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        for (const auto& entry : staged)
+        {
+            std::optional<uint64_t> old;
+            if (entry.second)
+            {
+                old = index_.put(entry.first, *entry.second);
+                live_bytes_ += record_size_at(*entry.second);
+            }
+            else
+                old = index_.erase(entry.first);
+            if (old)
+                live_bytes_ -= record_size_at(*old);
+        }
+        end_ = tail;
+    }
+
+    /// Store a new list and return its id.
+    uint64_t insert(const std::string& list)
+    {
+        change c{change::insert, 0, list};
+        commit({&c});
+        return c.id;
+    }
+
+    /// Replace an existing list. Returns false if there is no list with that id.
+    bool update(uint64_t id, const std::string& list)
+    {
+        change c{change::update, id, list};
+        commit({&c});
+        return c.found;
+    }
+
+    /// Delete a list. Returns false if there is no list with that id.
+    bool erase(uint64_t id)
+    {
+        change c{change::erase, id, {}};
+        commit({&c});
+        return c.found;
+    }
+
+    std::optional<std::string> get(uint64_t id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto offset = index_.find(id);
+        if (!offset)
+            return std::nullopt;
+        return value_at(*offset);
+    }
+
+    /// Every list, in id order.
+    std::vector<std::pair<uint64_t, std::string>> all() const
+    {
+        std::vector<std::pair<uint64_t, uint64_t>> offsets;
+        std::vector<std::pair<uint64_t, std::string>> lists;
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        offsets.reserve(index_.size());
+        index_.for_each([&](uint64_t id, uint64_t offset) {
+            offsets.emplace_back(id, offset);
+        });
+        std::sort(offsets.begin(), offsets.end());
+        lists.reserve(offsets.size());
+        for (const auto& entry : offsets)
+            lists.emplace_back(entry.first, value_at(entry.second));
+        return lists;
+    }
+
+private:
+    static constexpr uint8_t put_record = 1;
+    static constexpr uint8_t delete_record = 2;
+    static constexpr size_t header_size = 4 + 4 + 1 + 8;
+    static constexpr uint64_t min_capacity = 1 << 20;
+
+    struct header
+    {
+        uint32_t crc;
+        uint32_t length;
+        uint8_t type;
+        uint64_t id;
+    };
+
+    static uint32_t crc32(const char* data, size_t size, uint32_t crc = 0)
+    {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t{};
+            for (uint32_t i = 0; i < 256; i++)
+            {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++)
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                t[i] = c;
+            }
+            return t;
+        }();
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        return ~crc;
+    }
+
+    [[noreturn]] static void throw_errno(const char* op, const std::string& file)
+    {
+        int err = errno;
+        throw std::system_error(err, std::generic_category(), std::string(op) + " " + file);
+    }
+
+    header header_at(uint64_t offset) const
+    {
+        header h;
+        const char* p = base_ + offset;
+        std::memcpy(&h.crc, p, 4);
+        std::memcpy(&h.length, p + 4, 4);
+        std::memcpy(&h.type, p + 8, 1);
+        std::memcpy(&h.id, p + 9, 8);
+        return h;
+    }
+
+    uint64_t record_size_at(uint64_t offset) const
+    {
+        return header_size + header_at(offset).length;
+    }
+
+    std::string value_at(uint64_t offset) const
+    {
+        return std::string(base_ + offset + header_size, header_at(offset).length);
+    }
+
+    void lock_file()
+    {
+        std::string lock_path = path_ + ".lock";
+        lock_fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (lock_fd_ < 0)
+            throw_errno("open", lock_path);
+        if (::flock(lock_fd_, LOCK_EX | LOCK_NB) != 0)
+        {
+            if (errno == EWOULDBLOCK)
+                throw std::runtime_error(path_ + " is in use by another process");
+            throw_errno("flock", lock_path);
+        }
+    }
+
+    void open_file()
+    {
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0)
+            throw_errno("open", path_);
+        struct stat st;
+        if (::fstat(fd_, &st) != 0)
+            throw_errno("fstat", path_);
+        uint64_t capacity = min_capacity;
+        while (capacity < static_cast<uint64_t>(st.st_size))
+            capacity *= 2;
+        remap(capacity);
+    }
+
+    void unmap()
+    {
+        if (base_)
+            ::munmap(base_, capacity_);
+        base_ = nullptr;
+        capacity_ = 0;
+    }
+
+    // Callers other than the constructor must hold mutex_ exclusively.
+    void remap(uint64_t capacity)
+    {
+        if (::ftruncate(fd_, static_cast<off_t>(capacity)) != 0)
+            throw_errno("ftruncate", path_);
+        void* p = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (p == MAP_FAILED)
+            throw_errno("mmap", path_);
+        unmap();
+        base_ = static_cast<char*>(p);
+        capacity_ = capacity;
+    }
+
+    // Rebuild the index from the file.
+    void recover()
+    {
+        index_ = OffsetIndex();
+        live_bytes_ = 0;
+        next_id_ = 1;
+        uint64_t offset = 0;
+        while (offset + header_size <= capacity_)
+        {
+            header h = header_at(offset);
+            uint64_t size = header_size + h.length;
+            if ((h.type != put_record && h.type != delete_record) || h.id == 0 || h.id == ~uint64_t(0) ||
+                size > capacity_ - offset || crc32(base_ + offset + 4, size - 4) != h.crc)
+                break;
+
+            if (h.type == put_record)
+            {
+                if (auto old = index_.put(h.id, offset))
+                    live_bytes_ -= record_size_at(*old);
+                live_bytes_ += size;
+            }
+            else if (auto old = index_.erase(h.id))
+                live_bytes_ -= record_size_at(*old);
+            next_id_ = std::max(next_id_, h.id + 1);
+            offset += size;
+        }
+        end_ = offset;
+
+        if (std::any_of(base_ + end_, base_ + std::min(capacity_, end_ + header_size), [](char c) {
+                return c != 0;
+            }))
+            CROW_LOG_WARNING << "Log store " << path_ << ": discarding damaged data after offset " << end_;
+
+        // Zero everything past the last good record, so that leftovers of a
+        // torn write can never be mistaken for records once appends resume.
+        if (::ftruncate(fd_, static_cast<off_t>(end_)) != 0 || ::ftruncate(fd_, static_cast<off_t>(capacity_)) != 0)
+            throw_errno("ftruncate", path_);
+    }
+
+    // Rewrite the live records into a fresh file and swap it in.
+    void compact()
+    {
+        std::string tmp_path = path_ + ".compact";
+        int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+            throw_errno("open", tmp_path);
+
+        std::vector<std::pair<uint64_t, uint64_t>> offsets;
+        index_.for_each([&](uint64_t id, uint64_t offset) {
+            offsets.emplace_back(id, offset);
+        });
+        std::sort(offsets.begin(), offsets.end());
+
+        std::string buffer;
+        auto flush = [&] {
+            const char* p = buffer.data();
+            size_t left = buffer.size();
+            while (left > 0)
+            {
+                ssize_t n = ::write(fd, p, left);
+                if (n < 0 && errno == EINTR)
+                    continue;
+                if (n < 0)
+                {
+                    ::close(fd);
+                    throw_errno("write", tmp_path);
+                }
+                p += n;
+                left -= static_cast<size_t>(n);
+            }
+            buffer.clear();
+        };
+        for (const auto& entry : offsets)
+        {
+            buffer.append(base_ + entry.second, record_size_at(entry.second));
+            if (buffer.size() >= min_capacity)
+                flush();
+        }
+        // Keep the highest id ever handed out, so deleted ids are not reused.
+        if (next_id_ > 1 && (offsets.empty() || offsets.back().first + 1 < next_id_))
+            buffer += encode(delete_record, next_id_ - 1, {});
+        flush();
+
+        if (::fsync(fd) != 0)
+        {
+            ::close(fd);
+            throw_errno("fsync", tmp_path);
+        }
+        ::close(fd);
+        if (::rename(tmp_path.c_str(), path_.c_str()) != 0)
+            throw_errno("rename", tmp_path);
+
+        CROW_LOG_INFO << "Log store " << path_ << ": compacted " << end_ << " bytes to " << live_bytes_;
+        unmap();
+        ::close(fd_);
+        fd_ = -1;
+        open_file();
+    }
+
+    static std::string encode(uint8_t type, uint64_t id, const std::string& value)
+    {
+        std::string record(header_size + value.size(), '\0');
+        uint32_t length = static_cast<uint32_t>(value.size());
+        char* p = &record[0];
+        std::memcpy(p + 4, &length, 4);
+        std::memcpy(p + 8, &type, 1);
+        std::memcpy(p + 9, &id, 8);
+        std::memcpy(p + header_size, value.data(), value.size());
+        uint32_t crc = crc32(p + 4, record.size() - 4);
+        std::memcpy(p, &crc, 4);
+        return record;
+    }
+
+    // Write a record at offset (at or past end_) and return where it ends.
+    // Requires write_mutex_. Readers never look past end_, so the copy needs
+    // no other lock.
+    uint64_t append(uint8_t type, uint64_t id, const std::string& value, uint64_t offset)
+    {
+        if (value.size() > UINT32_MAX)
+            throw std::length_error("list too large");
+        std::string record = encode(type, id, value);
+        if (offset + record.size() > capacity_)
+        {
+            uint64_t capacity = capacity_;
+            while (offset + record.size() > capacity)
+                capacity *= 2;
+            std::unique_lock<std::shared_mutex> lock(mutex_);
+            remap(capacity);
+        }
+        std::memcpy(base_ + offset, record.data(), record.size());
+        return offset + record.size();
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    int lock_fd_ = -1;
+
+    // Serializes writers. Held for a whole commit(), flush included.
+    std::mutex write_mutex_;
+    uint64_t next_id_ = 1;
+
+    // Guards the mapping and the index against concurrent readers.
+    mutable std::shared_mutex mutex_;
+    char* base_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t end_ = 0;
+    uint64_t live_bytes_ = 0;
+    OffsetIndex index_;
+};
@@ -0,0 +1,137 @@
+#include "include/crow.h"   // Crow single-header
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <boost/asio.hpp>
+
+#include "log_store.h"
+#include "wal.h"
+
+// Lists live in a local append-only file instead of an external database.
+// Reads are an in-memory index lookup plus a copy out of the mapped file, so
+// they are answered directly on the io threads. Writes are handed to the
+// write-ahead log and the handler resumes once they are on disk.
+const std::string store_path = "lists.db";
+LogStore store{store_path};
+WriteAheadLog wal{store};
+
+crow::json::wvalue list_json(uint64_t id, const std::string& list)
+{
+    crow::json::wvalue item;
+    item["id"] = id;
+    item["list"] = list;
+    return item;
+}
+
+int main()
+{
+    crow::SimpleApp app;
+
+    // OPTIONS route for CORS (preflight requests)
+    CROW_ROUTE(app, "/<path>")
+        .methods("OPTIONS"_method)
+    ([](const crow::request&, crow::response& res, std::string) {
+        res.add_header("Access-Control-Allow-Origin", "*");
+        res.add_header("Access-Control-Allow-Methods", "GET, POST, PUT, DELETE, OPTIONS");
+        res.add_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
+        res.code = 200;
+        res.end();
+    });
+
+
+    // POST /lists – Create a new list item.
+    CROW_ROUTE(app, "/lists").methods("POST"_method)
+    ([](const crow::request& req) -> crow::task<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body)
+            co_return crow::response(400, "Invalid JSON");
+        if (!body.has("list"))
+            co_return crow::response(400, "Missing 'list' field");
+
+        std::string list_val = body["list"].s();
+        crow::json::wvalue result;
+        try {
+            auto inserted = co_await wal.insert(req, list_val);
+            result = list_json(inserted.id, list_val);
+        } catch (const std::exception &e) {
+            co_return crow::response(500, std::string("Storage error: ") + e.what());
+        }
+
+        crow::response res(result);
+        res.code = 201;
+        co_return res;
+    });
+
+    // GET /lists – Retrieve all list items.
+    CROW_ROUTE(app, "/lists").methods("GET"_method)
+    ([] {
+        std::vector<crow::json::wvalue> items;
+        for (const auto& entry : store.all())
+            items.push_back(list_json(entry.first, entry.second));
+        // Construct a JSON array from the vector.
+        crow::json::wvalue result(std::move(items));
+        return crow::response(result);
+    });
+
+
+    // GET /lists/<id> – Retrieve a specific list item.
+    CROW_ROUTE(app, "/lists/<uint>").methods("GET"_method)
+    ([](uint64_t id) {
+        auto list = store.get(id);
+        if (!list)
+            return crow::response(404, "Item not found");
+        return crow::response(list_json(id, *list));
+    });
+
+    // PUT /lists/<id> – Update a specific list item.
+    CROW_ROUTE(app, "/lists/<uint>").methods("PUT"_method)
+    ([](const crow::request& req, uint64_t id) -> crow::task<crow::response> {
+        auto body = crow::json::load(req.body);
+        if (!body)
+            co_return crow::response(400, "Invalid JSON");
+        if (!body.has("list"))
+            co_return crow::response(400, "Missing 'list' field");
+
+        std::string new_list = body["list"].s();
+        try {
+            auto updated = co_await wal.update(req, id, new_list);
+            if (!updated.found)
+                co_return crow::response(404, "Item not found");
+        } catch (const std::exception &e) {
+            co_return crow::response(500, std::string("Storage error: ") + e.what());
+        }
+        co_return crow::response(list_json(id, new_list));
+    });
+
+    // DELETE /lists/<id> – Delete a specific list item.
+    CROW_ROUTE(app, "/lists/<uint>").methods("DELETE"_method)
+    ([](const crow::request& req, uint64_t id) -> crow::task<crow::response> {
+        try {
+            auto erased = co_await wal.erase(req, id);
+            if (erased.found)
+                co_return crow::response(200, "Item deleted");
+            else
+                co_return crow::response(404, "Item not found");
+        } catch (const std::exception &e) {
+            co_return crow::response(500, std::string("Storage error: ") + e.what());
+        }
+    });
+
+    // LIST_API_SOCKET=/run/list_api.sock serves a reverse proxy on the same host
+    // through a Unix domain socket instead of TCP port 3000.
+    if (const char* socket_path = std::getenv("LIST_API_SOCKET"))
+        app.local_socket_path(socket_path);
+
+    // LIST_API_PIN_THREADS=1 pins every io thread to its own CPU, filling one
+    // NUMA node before the next.
+    if (std::getenv("LIST_API_PIN_THREADS"))
+        app.pin_io_threads();
+
+    // LIST_API_PER_CORE=1 gives every io thread its own listening socket
+    // (SO_REUSEPORT) and serves each connection on the thread that accepted it.
+    if (std::getenv("LIST_API_PER_CORE"))
+        app.per_core();
+
+    app.port(3000).multithreaded().run();
+    return 0;
+}
@@ -0,0 +1,268 @@
+// Differential check of crow::HTTPParser against the bare http_parser it wraps.
+//
+// Every request in the corpus below is parsed twice: once by http_parser with
+// callbacks that only collect what they are given, and once by HTTPParser, fed
+// in pieces of 1, 3 and 17 bytes and all at once. Both have to agree on every
+// request they return (method, URL, version, connection flags, headers in
+// order, body) and on whether the input is an error. Built with
+// -DCROW_USE_SIMD_PARSER, plain requests take the vectorized path in
+// include/crow/fast_parser.h, so run it both ways after touching the parser:
+//
+//   g++ -std=c++17 -O2 -DCROW_USE_BOOST=1 -I./include parser_check.cpp -o parser_check && ./parser_check
+//   g++ -std=c++17 -O2 -DCROW_USE_BOOST=1 -DCROW_USE_SIMD_PARSER -mavx2 -I./include parser_check.cpp -o parser_check && ./parser_check
+//
+// Exits with 1 and prints the differences if there are any.
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/crow/common.h"
+#include "include/crow/http_parser_merged.h"
+#include "include/crow/parser.h"
+
+namespace
+{
+    struct message
+    {
+        std::string method, url, body;
+        int major = 0, minor = 0;
+        bool keep_alive = false, close = false, upgrade = false;
+        std::vector<std::pair<std::string, std::string>> headers;
+
+        bool operator==(const message& other) const
+        {
+            return method == other.method && url == other.url && body == other.body && major == other.major && minor == other.minor &&
+                   keep_alive == other.keep_alive && close == other.close && upgrade == other.upgrade && headers == other.headers;
+        }
+    };
+
+    struct result
+    {
+        std::vector<message> messages;
+        bool error = false;
+
+        bool operator==(const result& other) const
+        {
+            return messages == other.messages && error == other.error;
+        }
+    };
+
+    std::string describe(const result& r)
+    {
+        std::string out;
+        for (auto& m : r.messages)
+        {
+            out += "  " + m.method + ' ' + m.url + " HTTP/" + std::to_string(m.major) + '.' + std::to_string(m.minor) +
+                   " keep_alive=" + std::to_string(m.keep_alive) + " close=" + std::to_string(m.close) + " upgrade=" + std::to_string(m.upgrade) + '\n';
+            for (auto& h : m.headers)
+                out += "    [" + h.first + "]: [" + h.second + "]\n";
+            out += "    body [" + m.body + "]\n";
+        }
+        out += r.error ? "  error\n" : "  ok\n";
+        return out;
+    }
+
+    /// The connection flags the way crow::HTTPParser derives them from http_parser's state.
+    void connection_flags(const crow::http_parser& p, message& m)
+    {
+        m.major = p.http_major;
+        m.minor = p.http_minor;
+        bool v10 = p.http_major == 1 && p.http_minor == 0, v11 = p.http_major == 1 && p.http_minor == 1;
+        m.keep_alive = v10 ? (p.flags & crow::F_CONNECTION_KEEP_ALIVE) != 0 : v11;
+        m.close = v10 ? (p.flags & crow::F_CONNECTION_KEEP_ALIVE) == 0 : v11 && (p.flags & crow::F_CONNECTION_CLOSE) != 0;
+        m.upgrade = p.upgrade;
+    }
+
+    /// http_parser on its own, the whole input at once, with the headers Crow keeps.
+    struct reference : crow::http_parser
+    {
+        result out;
+        message current;
+        bool in_value = false, headers_done = false;
+
+        static reference& self(crow::http_parser* p) { return *static_cast<reference*>(p); }
+
+        static int on_message_begin(crow::http_parser* p)
+        {
+            self(p).current = message{};
+            self(p).in_value = false;
+            self(p).headers_done = false;
+            return 0;
+        }
+        static int on_method(crow::http_parser* p)
+        {
+            self(p).current.method = crow::method_name(static_cast<crow::HTTPMethod>(p->method));
+            return 0;
+        }
+        static int on_url(crow::http_parser* p, const char* at, size_t length)
+        {
+            self(p).current.url.append(at, length);
+            return 0;
+        }
+        static int on_header_field(crow::http_parser* p, const char* at, size_t length)
+        {
+            auto& r = self(p);
+            if (r.headers_done)
+                return 0;
+            // Crow keeps a header with an empty value only if it is the last one.
+            if (r.in_value && r.current.headers.back().second.empty())
+                r.current.headers.pop_back();
+            if (r.in_value || r.current.headers.empty())
+                r.current.headers.emplace_back();
+            r.in_value = false;
+            r.current.headers.back().first.append(at, length);
+            return 0;
+        }
+        static int on_header_value(crow::http_parser* p, const char* at, size_t length)
+        {
+            auto& r = self(p);
+            if (r.headers_done)
+                return 0;
+            r.in_value = true;
+            r.current.headers.back().second.append(at, length);
+            return 0;
+        }
+        static int on_headers_complete(crow::http_parser* p)
+        {
+            connection_flags(*p, self(p).current);
+            // Crow doesn't keep trailers.
+            self(p).headers_done = true;
+            return 0;
+        }
+        static int on_body(crow::http_parser* p, const char* at, size_t length)
+        {
+            self(p).current.body.append(at, length);
+            return 0;
+        }
+        static int on_message_complete(crow::http_parser* p)
+        {
+            self(p).out.messages.push_back(std::move(self(p).current));
+            // Crow's copy of http_parser leaves the next message to the caller, see HTTPParser::clear().
+            p->state = crow::s_start_req;
+            return 0;
+        }
+
+        result run(const std::string& data)
+        {
+            static const crow::http_parser_settings settings{
+              on_message_begin, on_method, on_url, on_header_field, on_header_value, on_headers_complete, on_body, on_message_complete};
+            crow::http_parser_init(this);
+            crow::http_parser_execute(this, &settings, data.data(), data.size());
+            if (http_errno == crow::CHPE_OK)
+                crow::http_parser_execute(this, &settings, nullptr, 0);
+            out.error = http_errno != crow::CHPE_OK;
+            return out;
+        }
+    };
+
+    /// crow::HTTPParser, fed `chunk` bytes at a time like reads from a socket.
+    struct candidate
+    {
+        crow::HTTPParser<candidate>* parser = nullptr;
+        result out;
+
+        void handle_url() {}
+        void handle_header() {}
+        void handle()
+        {
+            auto& req = parser->req;
+            message m;
+            m.method = crow::method_name(req.method);
+            m.url = req.raw_url;
+            m.body = req.body;
+            m.major = req.http_ver_major;
+            m.minor = req.http_ver_minor;
+            m.keep_alive = req.keep_alive;
+            m.close = req.close_connection;
+            m.upgrade = req.upgrade;
+            for (auto& h : req.headers)
+                m.headers.emplace_back(std::string(h.first), std::string(h.second));
+            out.messages.push_back(std::move(m));
+            parser->clear();
+        }
+
+        result run(const std::string& data, size_t chunk)
+        {
+            crow::HTTPParser<candidate> p(this);
+            parser = &p;
+            bool ok = true;
+            for (size_t i = 0; i < data.size() && ok; i += chunk)
+                ok = p.feed(data.data() + i, static_cast<int>(std::min(chunk, data.size() - i)));
+            if (ok)
+                ok = p.done();
+            out.error = !ok;
+            return out;
+        }
+    };
+
+    // clang-format off
+    const char* const corpus[] = {
+      "GET / HTTP/1.1\r\nHost: x\r\n\r\n",
+      "GET /a/b?a=1&b=2 HTTP/1.1\r\nHost: example.com\r\nUser-Agent: curl/8.0 with spaces  \r\nAccept: */*\r\n\r\n",
+      "GET /a/rather/long/path/that/crosses/more/than/thirty/two/bytes?and=a&query=string HTTP/1.1\r\nhost: x\r\n\r\n",
+      "POST /echo HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nContent-Type: text/plain\r\n\r\nhelloGET /two HTTP/1.1\r\nHost: y\r\n\r\n",
+      "PUT /p?a=%20x HTTP/1.1\r\nHost: x\r\nContent-Length: 3\r\n\r\nabcPUT /p HTTP/1.1\r\nHost: x\r\nContent-Length: 2\r\n\r\nzzDELETE /d HTTP/1.1\r\n\r\n",
+      "POST /echo HTTP/1.0\r\nConnection: keep-alive\r\nContent-Length: 0\r\n\r\n",
+      "GET /old HTTP/1.0\r\nHost: x\r\n\r\n",
+      "GET /c HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n",
+      "GET /c HTTP/1.1\r\nHost: x\r\nConnection: Keep-Alive, Upgrade\r\nUpgrade: websocket\r\n\r\n",
+      "POST /chunk HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n6\r\n world\r\n0\r\nTrailer: t\r\n\r\n",
+      "POST /both HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\nTransfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n",
+      "GET /f#frag HTTP/1.1\r\nHost: x\r\n\r\n",
+      "GET /e HTTP/1.1\r\nHost: x\r\nEmpty:\r\nAfter: 1\r\n\r\n",
+      "GET /del HTTP/1.1\r\nX: \r\n\r\n",
+      "GET /fold HTTP/1.1\r\nHost: x\r\nX-F: a\r\n  b\r\n\r\n",
+      "GET /lf HTTP/1.1\nHost: x\n\n",
+      "BREW /coffee HTTP/1.1\r\nHost: x\r\n\r\n",
+      "GET /bad HTTP/1.1\r\nHo st: x\r\n\r\n",
+      "GET /bad HTTP/1.1\r\nHost: x\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\nab",
+      "GET /ws HTTP/1.1\r\nHost:\ttabbed\t\r\n\r\n",
+      "GET /v HTTP/2.0\r\nHost: x\r\n\r\n",
+      "GET http://abs/x HTTP/1.1\r\nHost: x\r\n\r\n",
+      "DELETE /d HTTP/1.1\r\nHost: x\r\nX-Long: aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\r\n\r\n",
+      "GET /ctl HTTP/1.1\r\nHost: x\r\nX-C: a\x01" "b\r\n\r\n",
+      "OPTIONS /o HTTP/1.1\r\nHost: x\r\nContent-Length: 10\r\n\r\nshort",
+      "GET /utf HTTP/1.1\r\nHost: x\r\nX-U: h\xc3\xa9llo w\xc3\xb6rld\r\n\r\n",
+      "GET /expect HTTP/1.1\r\nHost: x\r\nExpect: 100-continue\r\nContent-Length: 4\r\n\r\nbody",
+      "PATCH /p HTTP/1.1\r\nContent-Length: 18446744073709551616\r\n\r\n",
+      "HEAD /h HTTP/1.1\r\nCONTENT-LENGTH: 0\r\nCONNECTION: CLOSE\r\n\r\n",
+      "GET /space  HTTP/1.1\r\nHost: x\r\n\r\n",
+      "GET /truncated HTTP/1.1\r\nHost: x\r\n",
+      "POST /short HTTP/1.1\r\nContent-Length: 10\r\n\r\nabc",
+    };
+    // clang-format on
+
+    /// More headers than fast_parser.h takes in one go.
+    std::string many_headers()
+    {
+        std::string data = "GET /many HTTP/1.1\r\n";
+        for (int i = 0; i < 80; i++)
+            data += "X-H" + std::to_string(i) + ": value-" + std::to_string(i) + "\r\n";
+        return data + "\r\n";
+    }
+} // namespace
+
+int main()
+{
+    std::vector<std::string> inputs(std::begin(corpus), std::end(corpus));
+    inputs.push_back(many_headers());
+
+    int failures = 0;
+    for (size_t i = 0; i < inputs.size(); i++)
+    {
+        result expected = reference().run(inputs[i]);
+        for (size_t chunk : {size_t(1), size_t(3), size_t(17), inputs[i].size()})
+        {
+            result actual = candidate().run(inputs[i], chunk);
+            if (!(actual == expected))
+            {
+                failures++;
+                std::printf("case %zu, %zu byte reads:\nhttp_parser\n%sHTTPParser\n%s", i, chunk, describe(expected).c_str(), describe(actual).c_str());
+            }
+        }
+    }
+    std::printf("%zu requests, %d differences\n", inputs.size(), failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "include/crow.h"
+#include "log_store.h"
+
+// Group commit in front of LogStore: the store's data file is the write-ahead
+// log, and this is the single writer that appends to it.
+//
+// Handlers co_await insert()/update()/erase(). Each call pushes a node, which
+// lives in the handler's own coroutine frame, onto a lock-free stack and
+// suspends. The writer thread takes the whole stack in one exchange, commits
+// it to the store as a single batch (one fdatasync, however many writers are
+// waiting) and resumes every handler on the io thread it came from. Writes
+// that arrive during a flush wait for the next one, so batches grow with load
+// and the cost of a flush is shared by everyone in the batch.
+//
+// A handler is only resumed once its write is on disk. After a crash, the
+// store's recovery scan replays the file up to the last complete record,
+// which covers every write that was acknowledged.
+class WriteAheadLog
+{
+public:
+    /// Awaitable for a single write. Resumes with the committed LogStore::change.
+    class pending
+    {
+    public:
+        pending(WriteAheadLog* wal, crow::asio::io_context* io_context, LogStore::change change):
+          wal_(wal), io_context_(io_context), change_(std::move(change))
+        {}
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> awaiting)
+        {
+            awaiting_ = awaiting;
+            wal_->push(this);
+        }
+
+        LogStore::change await_resume()
+        {
+            if (error_)
+                std::rethrow_exception(error_);
+            return std::move(change_);
+        }
+
+    private:
+        friend class WriteAheadLog;
+
+        void resume()
+        {
+            auto awaiting = awaiting_;
+            if (io_context_)
+                crow::asio::post(*io_context_, [awaiting] {
+                    awaiting.resume();
+                });
+            else
+                awaiting.resume();
+        }
+
+        WriteAheadLog* wal_;
+        crow::asio::io_context* io_context_;
+        LogStore::change change_;
+        std::coroutine_handle<> awaiting_;
+        std::exception_ptr error_;
+        pending* next_ = nullptr;
+    };
+
+    explicit WriteAheadLog(LogStore& store):
+      store_(store), stop_(nullptr, nullptr, LogStore::change{})
+    {
+        writer_ = std::thread([this] {
+            writer_loop();
+        });
+    }
+
+    /// Commit whatever is queued, then stop the writer.
+    ~WriteAheadLog()
+    {
+        push(&stop_);
+        writer_.join();
+    }
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    /// `co_await wal.insert(req, list)`; the new id is in `.id`.
+    pending insert(const crow::request& req, std::string list)
+    {
+        return {this, req.io_context, LogStore::change{LogStore::change::insert, 0, std::move(list)}};
+    }
+
+    /// `co_await wal.update(req, id, list)`; `.found` is false if there is no such list.
+    pending update(const crow::request& req, uint64_t id, std::string list)
+    {
+        return {this, req.io_context, LogStore::change{LogStore::change::update, id, std::move(list)}};
+    }
+
+    /// `co_await wal.erase(req, id)`; `.found` is false if there is no such list.
+    pending erase(const crow::request& req, uint64_t id)
+    {
+        return {this, req.io_context, LogStore::change{LogStore::change::erase, id, {}}};
+    }
+
+private:
+    void push(pending* p)
+    {
+        pending* head = head_.load(std::memory_order_relaxed);
+        do
+        {
+            p->next_ = head;
+        } while (!head_.compare_exchange_weak(head, p, std::memory_order_release, std::memory_order_relaxed));
+        // Only the push onto an empty stack can find the writer asleep.
+        if (!head)
+            head_.notify_one();
+    }
+
+    void writer_loop()
+    {
+        std::vector<pending*> batch;
+        std::vector<LogStore::change*> changes;
+        bool stopping = false;
+        while (!stopping)
+        {
+            head_.wait(nullptr, std::memory_order_acquire);
+            pending* p = head_.exchange(nullptr, std::memory_order_acquire);
+
+            // The stack is newest first; commit in arrival order.
+            batch.clear();
+            changes.clear();
+            for (; p; p = p->next_)
+            {
+                if (p == &stop_)
+                    stopping = true;
+                else
+                    batch.push_back(p);
+            }
+            if (batch.empty())
+                continue;
+            std::reverse(batch.begin(), batch.end());
+            for (pending* w : batch)
+                changes.push_back(&w->change_);
+
+            std::exception_ptr error;
+            try
+            {
+                store_.commit(changes);
+            }
+            catch (const std::exception& e)
+            {
+                CROW_LOG_ERROR << "Write-ahead log commit of " << batch.size() << " writes failed: " << e.what();
+                error = std::current_exception();
+            }
+            // A resumed handler may destroy its node, so this is the last use of each.
+            for (pending* w : batch)
+            {
+                w->error_ = error;
+                w->resume();
+            }
+        }
+    }
+
+    LogStore& store_;
+    std::atomic<pending*> head_{nullptr};
+    pending stop_;
+    std::thread writer_;
+};
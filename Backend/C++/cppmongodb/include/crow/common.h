@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <stdexcept>
 #include <iostream>
 #include "crow/utility.h"
@@ -210,6 +212,62 @@ namespace crow
         VARIANT_ALSO_NEGOTIATES       = 506
     };
 
+    namespace detail
+    {
+        /// The status line sent for a code, CRLF included, or an empty view for a code missing from \ref status.
+        inline std::string_view status_line(int code)
+        {
+            // TODO(EDev): HTTP version in status codes should be dynamic
+            static constexpr auto lines = [] {
+                std::array<std::string_view, 600> l{};
+                l[CONTINUE]                      = "HTTP/1.1 100 Continue\r\n";
+                l[SWITCHING_PROTOCOLS]           = "HTTP/1.1 101 Switching Protocols\r\n";
+
+                l[OK]                            = "HTTP/1.1 200 OK\r\n";
+                l[CREATED]                       = "HTTP/1.1 201 Created\r\n";
+                l[ACCEPTED]                      = "HTTP/1.1 202 Accepted\r\n";
+                l[NON_AUTHORITATIVE_INFORMATION] = "HTTP/1.1 203 Non-Authoritative Information\r\n";
+                l[NO_CONTENT]                    = "HTTP/1.1 204 No Content\r\n";
+                l[RESET_CONTENT]                 = "HTTP/1.1 205 Reset Content\r\n";
+                l[PARTIAL_CONTENT]               = "HTTP/1.1 206 Partial Content\r\n";
+
+                l[MULTIPLE_CHOICES]              = "HTTP/1.1 300 Multiple Choices\r\n";
+                l[MOVED_PERMANENTLY]             = "HTTP/1.1 301 Moved Permanently\r\n";
+                l[FOUND]                         = "HTTP/1.1 302 Found\r\n";
+                l[SEE_OTHER]                     = "HTTP/1.1 303 See Other\r\n";
+                l[NOT_MODIFIED]                  = "HTTP/1.1 304 Not Modified\r\n";
+                l[TEMPORARY_REDIRECT]            = "HTTP/1.1 307 Temporary Redirect\r\n";
+                l[PERMANENT_REDIRECT]            = "HTTP/1.1 308 Permanent Redirect\r\n";
+
+                l[BAD_REQUEST]                   = "HTTP/1.1 400 Bad Request\r\n";
+                l[UNAUTHORIZED]                  = "HTTP/1.1 401 Unauthorized\r\n";
+                l[FORBIDDEN]                     = "HTTP/1.1 403 Forbidden\r\n";
+                l[NOT_FOUND]                     = "HTTP/1.1 404 Not Found\r\n";
+                l[METHOD_NOT_ALLOWED]            = "HTTP/1.1 405 Method Not Allowed\r\n";
+                l[NOT_ACCEPTABLE]                = "HTTP/1.1 406 Not Acceptable\r\n";
+                l[PROXY_AUTHENTICATION_REQUIRED] = "HTTP/1.1 407 Proxy Authentication Required\r\n";
+                l[CONFLICT]                      = "HTTP/1.1 409 Conflict\r\n";
+                l[GONE]                          = "HTTP/1.1 410 Gone\r\n";
+                l[PAYLOAD_TOO_LARGE]             = "HTTP/1.1 413 Payload Too Large\r\n";
+                l[UNSUPPORTED_MEDIA_TYPE]        = "HTTP/1.1 415 Unsupported Media Type\r\n";
+                l[RANGE_NOT_SATISFIABLE]         = "HTTP/1.1 416 Range Not Satisfiable\r\n";
+                l[EXPECTATION_FAILED]            = "HTTP/1.1 417 Expectation Failed\r\n";
+                l[PRECONDITION_REQUIRED]         = "HTTP/1.1 428 Precondition Required\r\n";
+                l[TOO_MANY_REQUESTS]             = "HTTP/1.1 429 Too Many Requests\r\n";
+                l[UNAVAILABLE_FOR_LEGAL_REASONS] = "HTTP/1.1 451 Unavailable For Legal Reasons\r\n";
+
+                l[INTERNAL_SERVER_ERROR]         = "HTTP/1.1 500 Internal Server Error\r\n";
+                l[NOT_IMPLEMENTED]               = "HTTP/1.1 501 Not Implemented\r\n";
+                l[BAD_GATEWAY]                   = "HTTP/1.1 502 Bad Gateway\r\n";
+                l[SERVICE_UNAVAILABLE]           = "HTTP/1.1 503 Service Unavailable\r\n";
+                l[GATEWAY_TIMEOUT]               = "HTTP/1.1 504 Gateway Timeout\r\n";
+                l[VARIANT_ALSO_NEGOTIATES]       = "HTTP/1.1 506 Variant Also Negotiates\r\n";
+                return l;
+            }();
+            return code >= 0 && code < static_cast<int>(lines.size()) ? lines[code] : std::string_view();
+        }
+    } // namespace detail
+
     // clang-format on
 
     enum class ParamType : char
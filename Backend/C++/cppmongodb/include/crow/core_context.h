@@ -0,0 +1,88 @@
+#pragma once
+
+#include "crow/settings.h"
+
+#ifdef CROW_USE_BOOST
+#include <boost/asio.hpp>
+#else
+#ifndef ASIO_STANDALONE
+#define ASIO_STANDALONE
+#endif
+#include <asio.hpp>
+#endif
+
+#include <memory>
+#include <stdexcept>
+#include <typeinfo>
+#include <utility>
+
+#include "crow/task_timer.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+#ifdef CROW_USE_BOOST
+    namespace asio = boost::asio;
+#endif
+
+    /// What belongs to one io thread: its io_context, its timer and a slot for handler resources.
+
+    ///
+    /// Handlers reach the context of the thread they run on through \ref this_core(). Whatever is put into the slot
+    /// (a database connection, a cache shard) is only ever used by that thread, so it needs no locking, and it is
+    /// destroyed on that thread when the server stops.
+    class core_context
+    {
+    public:
+        core_context(unsigned index, asio::io_context& io_context, detail::task_timer& timer):
+          index(index), io_context(io_context), timer(timer)
+        {}
+
+        core_context(const core_context&) = delete;
+        core_context& operator=(const core_context&) = delete;
+
+        /// Position of the io thread, from 0 to the number of io threads - 1.
+        const unsigned index;
+        asio::io_context& io_context;
+        detail::task_timer& timer;
+
+        /// Construct a T in the slot, replacing what was there.
+        template<typename T, typename... Args>
+        T& emplace(Args&&... args)
+        {
+            auto value = std::make_shared<T>(std::forward<Args>(args)...);
+            T& ref = *value;
+            slot_ = std::move(value);
+            slot_type_ = &typeid(T);
+            return ref;
+        }
+
+        /// The T in the slot. Throws if the slot is empty or holds another type.
+        template<typename T>
+        T& get()
+        {
+            if (!slot_ || *slot_type_ != typeid(T))
+                throw std::runtime_error(std::string("this core has no ") + typeid(T).name());
+            return *static_cast<T*>(slot_.get());
+        }
+
+        bool has_value() const
+        {
+            return static_cast<bool>(slot_);
+        }
+
+    private:
+        std::shared_ptr<void> slot_;
+        const std::type_info* slot_type_ = nullptr;
+    };
+
+    namespace detail
+    {
+        inline thread_local core_context* current_core = nullptr;
+    } // namespace detail
+
+    /// The context of the io thread the caller runs on, or nullptr outside the io threads.
+    inline core_context* this_core()
+    {
+        return detail::current_core;
+    }
+} // namespace crow
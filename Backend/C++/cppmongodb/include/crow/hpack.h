@@ -0,0 +1,456 @@
+#pragma once
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// HPACK header compression for HTTP/2 (RFC 7541).
+        namespace hpack
+        {
+            struct header_field
+            {
+                std::string name;
+                std::string value;
+            };
+
+            /// Entries 1 to 61 of the static table (Appendix A). Entry 0 is unused.
+            inline const std::array<std::pair<const char*, const char*>, 62>& static_table()
+            {
+                static const std::array<std::pair<const char*, const char*>, 62> table = {{
+                  {"", ""},
+                  {":authority", ""},
+                  {":method", "GET"},
+                  {":method", "POST"},
+                  {":path", "/"},
+                  {":path", "/index.html"},
+                  {":scheme", "http"},
+                  {":scheme", "https"},
+                  {":status", "200"},
+                  {":status", "204"},
+                  {":status", "206"},
+                  {":status", "304"},
+                  {":status", "400"},
+                  {":status", "404"},
+                  {":status", "500"},
+                  {"accept-charset", ""},
+                  {"accept-encoding", "gzip, deflate"},
+                  {"accept-language", ""},
+                  {"accept-ranges", ""},
+                  {"accept", ""},
+                  {"access-control-allow-origin", ""},
+                  {"age", ""},
+                  {"allow", ""},
+                  {"authorization", ""},
+                  {"cache-control", ""},
+                  {"content-disposition", ""},
+                  {"content-encoding", ""},
+                  {"content-language", ""},
+                  {"content-length", ""},
+                  {"content-location", ""},
+                  {"content-range", ""},
+                  {"content-type", ""},
+                  {"cookie", ""},
+                  {"date", ""},
+                  {"etag", ""},
+                  {"expect", ""},
+                  {"expires", ""},
+                  {"from", ""},
+                  {"host", ""},
+                  {"if-match", ""},
+                  {"if-modified-since", ""},
+                  {"if-none-match", ""},
+                  {"if-range", ""},
+                  {"if-unmodified-since", ""},
+                  {"last-modified", ""},
+                  {"link", ""},
+                  {"location", ""},
+                  {"max-forwards", ""},
+                  {"proxy-authenticate", ""},
+                  {"proxy-authorization", ""},
+                  {"range", ""},
+                  {"referer", ""},
+                  {"refresh", ""},
+                  {"retry-after", ""},
+                  {"server", ""},
+                  {"set-cookie", ""},
+                  {"strict-transport-security", ""},
+                  {"transfer-encoding", ""},
+                  {"user-agent", ""},
+                  {"vary", ""},
+                  {"via", ""},
+                  {"www-authenticate", ""},
+                }};
+                return table;
+            }
+
+            /// Decodes Huffman coded string literals (Appendix B) by walking a binary tree built from the code table.
+            class huffman_decoder
+            {
+            public:
+                static const huffman_decoder& instance()
+                {
+                    static const huffman_decoder decoder;
+                    return decoder;
+                }
+
+                /// Append the decoded form of `data` to `out`. Returns false if it isn't a valid Huffman coded string.
+                bool decode(const uint8_t* data, size_t size, std::string& out) const
+                {
+                    int node = 0;
+                    unsigned int padding_bits = 0;
+                    bool padding_ones = true;
+                    for (size_t i = 0; i < size; i++)
+                    {
+                        for (int bit = 7; bit >= 0; bit--)
+                        {
+                            int b = (data[i] >> bit) & 1;
+                            node = nodes_[node].next[b];
+                            if (node <= 0)
+                                return false;
+                            padding_bits++;
+                            padding_ones = padding_ones && b;
+                            if (nodes_[node].symbol >= 0)
+                            {
+                                if (nodes_[node].symbol == 256)
+                                    return false; // EOS must not appear in a string
+                                out.push_back(static_cast<char>(nodes_[node].symbol));
+                                node = 0;
+                                padding_bits = 0;
+                                padding_ones = true;
+                            }
+                        }
+                    }
+                    // What is left has to be a prefix of EOS (all ones) shorter than a byte.
+                    return padding_bits < 8 && padding_ones;
+                }
+
+            private:
+                struct node
+                {
+                    int next[2] = {0, 0};
+                    int symbol = -1;
+                };
+
+                huffman_decoder()
+                {
+                    static constexpr uint32_t codes[256] = {
+                      0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+                      0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+                      0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+                      0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+                      0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+                      0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+                      0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+                      0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+                      0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+                      0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+                      0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+                      0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+                      0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+                      0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+                      0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+                      0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+                      0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+                      0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+                      0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+                      0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+                      0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+                      0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+                      0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+                      0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+                      0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+                      0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+                      0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+                      0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+                      0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+                      0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+                      0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+                      0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+                    };
+                    static constexpr uint8_t lengths[256] = {
+                      13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+                      28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+                      6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+                      5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+                      13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+                      7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+                      15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+                      6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+                      20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+                      24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+                      22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+                      21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+                      26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+                      19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+                      20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+                      26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+                    };
+                    nodes_.emplace_back();
+                    for (int symbol = 0; symbol <= 256; symbol++)
+                    {
+                        uint32_t code = symbol < 256 ? codes[symbol] : 0x3fffffff;
+                        int length = symbol < 256 ? lengths[symbol] : 30;
+                        int current = 0;
+                        for (int bit = length - 1; bit >= 0; bit--)
+                        {
+                            int b = (code >> bit) & 1;
+                            if (nodes_[current].next[b] == 0)
+                            {
+                                nodes_[current].next[b] = static_cast<int>(nodes_.size());
+                                nodes_.emplace_back();
+                            }
+                            current = nodes_[current].next[b];
+                        }
+                        nodes_[current].symbol = symbol;
+                    }
+                }
+
+                std::vector<node> nodes_;
+            };
+
+            /// Turns header blocks into header lists, keeping the dynamic table in step with the peer's encoder.
+
+            ///
+            /// One decoder per connection; header blocks have to be decoded in the order they were received.
+            class decoder
+            {
+            public:
+                /// `max_list_size` limits the decoded size of a header block, counted like SETTINGS_MAX_HEADER_LIST_SIZE.
+                explicit decoder(size_t max_table_size = 4096, size_t max_list_size = SIZE_MAX):
+                  max_size_(max_table_size), settings_max_size_(max_table_size), max_list_size_(max_list_size)
+                {}
+
+                /// Decode a complete header block into `headers`. Returns false on a compression error.
+
+                ///
+                /// A block that decodes to more than the list size limit is one too, since a few bytes that refer to a
+                /// large table entry can otherwise expand to a huge header list.
+                bool decode(const uint8_t* data, size_t size, std::vector<header_field>& headers)
+                {
+                    const uint8_t* p = data;
+                    const uint8_t* end = data + size;
+                    bool fields_seen = false;
+                    size_t list_size = 0;
+                    while (p < end)
+                    {
+                        uint64_t index;
+                        if (*p & 0x80) // Indexed header field
+                        {
+                            if (!decode_integer(p, end, 7, index) || index == 0)
+                                return false;
+                            header_field field;
+                            if (!lookup(index, field))
+                                return false;
+                            list_size += entry_size(field);
+                            if (list_size > max_list_size_)
+                                return false;
+                            headers.push_back(std::move(field));
+                            fields_seen = true;
+                        }
+                        else if ((*p & 0xe0) == 0x20) // Dynamic table size update, only allowed before the first field
+                        {
+                            if (fields_seen || !decode_integer(p, end, 5, index) || index > settings_max_size_)
+                                return false;
+                            max_size_ = static_cast<size_t>(index);
+                            evict(0);
+                        }
+                        else // Literal, with incremental indexing (01), without indexing (0000) or never indexed (0001)
+                        {
+                            bool indexing = (*p & 0xc0) == 0x40;
+                            if (!decode_integer(p, end, indexing ? 6 : 4, index))
+                                return false;
+                            header_field field;
+                            if (index != 0)
+                            {
+                                if (!lookup(index, field))
+                                    return false;
+                            }
+                            else if (!decode_string(p, end, field.name))
+                                return false;
+                            if (!decode_string(p, end, field.value))
+                                return false;
+                            if (indexing)
+                                insert(field);
+                            list_size += entry_size(field);
+                            if (list_size > max_list_size_)
+                                return false;
+                            headers.push_back(std::move(field));
+                            fields_seen = true;
+                        }
+                    }
+                    return true;
+                }
+
+            private:
+                static bool decode_integer(const uint8_t*& p, const uint8_t* end, int prefix_bits, uint64_t& value)
+                {
+                    uint8_t mask = static_cast<uint8_t>((1 << prefix_bits) - 1);
+                    value = *p++ & mask;
+                    if (value < mask)
+                        return true;
+                    for (int shift = 0; p < end && shift <= 56; shift += 7)
+                    {
+                        uint8_t b = *p++;
+                        value += static_cast<uint64_t>(b & 0x7f) << shift;
+                        if (!(b & 0x80))
+                            return true;
+                    }
+                    return false;
+                }
+
+                static bool decode_string(const uint8_t*& p, const uint8_t* end, std::string& out)
+                {
+                    if (p >= end)
+                        return false;
+                    bool huffman = *p & 0x80;
+                    uint64_t length;
+                    if (!decode_integer(p, end, 7, length) || length > static_cast<uint64_t>(end - p))
+                        return false;
+                    bool ok = true;
+                    out.clear();
+                    if (huffman)
+                        ok = huffman_decoder::instance().decode(p, static_cast<size_t>(length), out);
+                    else
+                        out.assign(reinterpret_cast<const char*>(p), static_cast<size_t>(length));
+                    p += length;
+                    return ok;
+                }
+
+                bool lookup(uint64_t index, header_field& field) const
+                {
+                    const auto& table = static_table();
+                    if (index < table.size())
+                    {
+                        field.name = table[index].first;
+                        field.value = table[index].second;
+                        return true;
+                    }
+                    index -= table.size();
+                    if (index >= dynamic_.size())
+                        return false;
+                    field = dynamic_[static_cast<size_t>(index)];
+                    return true;
+                }
+
+                void insert(const header_field& field)
+                {
+                    size_t size = entry_size(field);
+                    evict(size);
+                    // An entry larger than the whole table just empties it.
+                    if (size <= max_size_)
+                    {
+                        dynamic_.push_front(field);
+                        size_ += size;
+                    }
+                }
+
+                /// Drop the oldest entries until `room` more bytes fit.
+                void evict(size_t room)
+                {
+                    while (!dynamic_.empty() && size_ + room > max_size_)
+                    {
+                        size_ -= entry_size(dynamic_.back());
+                        dynamic_.pop_back();
+                    }
+                }
+
+                static size_t entry_size(const header_field& field)
+                {
+                    return field.name.size() + field.value.size() + 32;
+                }
+
+                std::deque<header_field> dynamic_;
+                size_t size_ = 0;
+                size_t max_size_;
+                size_t settings_max_size_;
+                size_t max_list_size_;
+            };
+
+            /// Turns header lists into header blocks.
+
+            ///
+            /// Never adds to the dynamic table and never Huffman codes, so it keeps no state and the peer's table size
+            /// setting doesn't matter. Fields that are in the static table whole (`:status: 200`) take one byte, others
+            /// reuse a static name where there is one.
+            class encoder
+            {
+            public:
+                static void encode(std::string_view name, std::string_view value, std::string& out)
+                {
+                    const auto& fields = static_fields();
+                    std::string field;
+                    field.reserve(name.size() + 1 + value.size());
+                    field.append(name).append(1, '\0').append(value);
+                    auto it = fields.find(field);
+                    if (it != fields.end())
+                    {
+                        encode_integer(it->second, 7, 0x80, out);
+                        return;
+                    }
+                    field.resize(name.size());
+                    it = fields.find(field);
+                    if (it != fields.end())
+                        encode_integer(it->second, 4, 0x00, out);
+                    else
+                    {
+                        out.push_back(0x00);
+                        encode_string(name, out);
+                    }
+                    encode_string(value, out);
+                }
+
+                static void encode_integer(uint64_t value, int prefix_bits, uint8_t first_byte, std::string& out)
+                {
+                    uint64_t mask = (1u << prefix_bits) - 1;
+                    if (value < mask)
+                    {
+                        out.push_back(static_cast<char>(first_byte | value));
+                        return;
+                    }
+                    out.push_back(static_cast<char>(first_byte | mask));
+                    value -= mask;
+                    while (value >= 0x80)
+                    {
+                        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+                        value >>= 7;
+                    }
+                    out.push_back(static_cast<char>(value));
+                }
+
+            private:
+                static void encode_string(std::string_view value, std::string& out)
+                {
+                    encode_integer(value.size(), 7, 0x00, out);
+                    out += value;
+                }
+
+                /// Static table indices by name (first entry with that name) and by name and value (separated by a 0 byte).
+                static const std::unordered_map<std::string, uint64_t>& static_fields()
+                {
+                    static const std::unordered_map<std::string, uint64_t> fields = [] {
+                        std::unordered_map<std::string, uint64_t> result;
+                        const auto& table = static_table();
+                        for (size_t i = table.size() - 1; i > 0; i--)
+                        {
+                            result[table[i].first] = i;
+                            if (*table[i].second)
+                                result[std::string(table[i].first) + '\0' + table[i].second] = i;
+                        }
+                        return result;
+                    }();
+                    return fields;
+                }
+            };
+        } // namespace hpack
+    } // namespace detail
+} // namespace crow
@@ -0,0 +1,1084 @@
+#pragma once
+
+#include "crow/settings.h"
+
+#ifdef CROW_USE_BOOST
+#include <boost/asio.hpp>
+#else
+#ifndef ASIO_STANDALONE
+#define ASIO_STANDALONE
+#endif
+#include <asio.hpp>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "crow/common.h"
+#include "crow/compression.h"
+#include "crow/file_cache.h"
+#include "crow/hpack.h"
+#include "crow/http_date.h"
+#include "crow/http_parser_merged.h"
+#include "crow/http_request.h"
+#include "crow/http_response.h"
+#include "crow/load_balancer.h"
+#include "crow/logging.h"
+#include "crow/middleware.h"
+#include "crow/middleware_context.h"
+#include "crow/task_timer.h"
+#include "crow/utility.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+#ifdef CROW_USE_BOOST
+    namespace asio = boost::asio;
+    using error_code = boost::system::error_code;
+#else
+    using error_code = asio::error_code;
+#endif
+
+    /**
+     * \namespace crow::http2
+     * \brief Cleartext HTTP/2 (h2c), entered with prior knowledge or through an HTTP/1.1 `Upgrade: h2c`.
+     *
+     * Every stream runs through the same routing and middleware as an HTTP/1 request.
+     */
+    namespace http2
+    {
+        /// The first bytes a client sends on an HTTP/2 connection (RFC 9113 section 3.4).
+        static const std::string connection_preface = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+        enum frame_type : uint8_t
+        {
+            DATA = 0x0,
+            HEADERS = 0x1,
+            PRIORITY = 0x2,
+            RST_STREAM = 0x3,
+            SETTINGS = 0x4,
+            PUSH_PROMISE = 0x5,
+            PING = 0x6,
+            GOAWAY = 0x7,
+            WINDOW_UPDATE = 0x8,
+            CONTINUATION = 0x9,
+        };
+
+        enum frame_flag : uint8_t
+        {
+            ACK = 0x1,
+            END_STREAM = 0x1,
+            END_HEADERS = 0x4,
+            PADDED = 0x8,
+            PRIORITY_FLAG = 0x20,
+        };
+
+        enum setting : uint16_t
+        {
+            HEADER_TABLE_SIZE = 0x1,
+            ENABLE_PUSH = 0x2,
+            MAX_CONCURRENT_STREAMS = 0x3,
+            INITIAL_WINDOW_SIZE = 0x4,
+            MAX_FRAME_SIZE = 0x5,
+            MAX_HEADER_LIST_SIZE = 0x6,
+        };
+
+        /// Error codes of RST_STREAM and GOAWAY (RFC 9113 section 7).
+        enum class error : uint32_t
+        {
+            no_error = 0x0,
+            protocol_error = 0x1,
+            internal_error = 0x2,
+            flow_control_error = 0x3,
+            stream_closed = 0x5,
+            frame_size_error = 0x6,
+            refused_stream = 0x7,
+            cancel = 0x8,
+            compression_error = 0x9,
+            enhance_your_calm = 0xb,
+        };
+
+        /// Largest frame payload the server accepts, the protocol's default.
+        static constexpr uint32_t max_frame_size = 16384;
+        /// Flow control window of a new stream (and of the connection) until SETTINGS say otherwise.
+        static constexpr int64_t default_window_size = 65535;
+        static constexpr int64_t max_window_size = 0x7fffffff;
+        /// Largest header block (HEADERS plus CONTINUATION frames) accepted for one request.
+        static constexpr size_t max_header_block_size = 80 * 1024;
+        /// Largest decoded header list (names, values and 32 bytes per field) accepted for one request, as HTTP/1.1 allows.
+        static constexpr size_t max_header_list_size = CROW_HTTP_MAX_HEADER_SIZE;
+        /// Roughly how much is handed to the socket per write.
+        static constexpr size_t write_batch_size = 64 * 1024;
+
+        /// One request and its response.
+        template<typename... Middlewares>
+        struct stream
+        {
+            uint32_t id;
+            request req;
+            response res;
+            detail::context<Middlewares...> ctx;
+            std::unique_ptr<crow::routing_handle_result> routing;
+
+            bool remote_closed = false;          ///< The client has sent END_STREAM.
+            bool in_flight = false;              ///< Handed to the app, not answered yet.
+            bool need_to_call_after_handlers = false;
+            bool reset = false;                  ///< Cancelled by RST_STREAM while the app was handling it.
+            bool responding = false;             ///< Headers are queued; the body is being sent.
+            bool end_stream_sent = false;
+
+            int64_t send_window = default_window_size;
+            std::string body;
+            std::shared_ptr<const std::string> shared_body; ///< Sent instead of `body`, e.g. a cached static asset.
+            std::shared_ptr<const detail::cached_file> file;
+            uint64_t sent = 0;                   ///< Bytes of the body (or file) already sent.
+
+            uint64_t body_size() const
+            {
+                if (file)
+                    return static_cast<uint64_t>(file->statbuf.st_size);
+                return shared_body ? shared_body->size() : body.size();
+            }
+        };
+
+        /// An HTTP/2 connection, taking over the socket of an HTTP/1 \ref crow::Connection.
+
+        ///
+        /// Frames are read into one buffer and handled as they complete. Responses are HPACK encoded into HEADERS
+        /// frames, and their bodies go out as DATA frames, round robin over the streams, within the flow control windows
+        /// the client grants. Everything queued is sent with one write at a time. The server's own receive windows are
+        /// topped up as soon as DATA is read, so uploads are only limited by the request being buffered in memory.
+        template<typename Adaptor, typename Handler, typename... Middlewares>
+        class Connection : public std::enable_shared_from_this<Connection<Adaptor, Handler, Middlewares...>>
+        {
+            using stream_t = stream<Middlewares...>;
+
+        public:
+            Connection(Adaptor&& adaptor,
+                       Handler* handler,
+                       const std::string& server_name,
+                       std::tuple<Middlewares...>* middlewares,
+                       detail::task_timer& task_timer,
+                       detail::io_context_load& load):
+              adaptor_(std::move(adaptor)),
+              handler_(handler),
+              server_name_(server_name),
+              middlewares_(middlewares),
+              task_timer_(task_timer),
+              load_(load)
+            {
+                load_.connections++;
+            }
+
+            ~Connection()
+            {
+                for (auto& kv : streams_)
+                    if (kv.second->in_flight)
+                        load_.in_flight--;
+                load_.connections--;
+            }
+
+            /// Start with a client that sent the connection preface right away (prior knowledge).
+
+            ///
+            /// `received` holds what has been read so far, beginning with (part of) the preface.
+            void start(const char* received, size_t size)
+            {
+                CROW_LOG_DEBUG << this << " HTTP/2 with prior knowledge";
+                queue_settings();
+                input_.assign(received, size);
+                process_input();
+                if (!closing_)
+                    do_read();
+                flush();
+            }
+
+            /// Continue a connection upgraded from HTTP/1.1. The request that asked for the upgrade becomes stream 1.
+
+            ///
+            /// `settings` is the client's `HTTP2-Settings` header, `received` whatever it sent after the request.
+            void start_upgraded(request&& req, const std::string& settings, const char* received, size_t size)
+            {
+                CROW_LOG_DEBUG << this << " upgraded to HTTP/2";
+                pending_ = "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+                queue_settings();
+
+                std::string payload = utility::base64decode(settings, settings.size());
+                if (payload.size() % 6 != 0 || apply_settings(reinterpret_cast<const uint8_t*>(payload.data()), payload.size()) != error::no_error)
+                {
+                    goaway(error::protocol_error);
+                    return;
+                }
+
+                last_stream_id_ = 1;
+                auto& s = new_stream(1);
+                s.req = std::move(req);
+                s.req.http_ver_major = 2;
+                s.req.http_ver_minor = 0;
+                s.req.upgrade = false;
+                s.remote_closed = true;
+                dispatch(s);
+
+                input_.assign(received, size);
+                process_input();
+                if (!closing_)
+                    do_read();
+                flush();
+            }
+
+        private:
+            void do_read()
+            {
+                auto self = this->shared_from_this();
+                adaptor_.socket().async_read_some(
+                  asio::buffer(read_buffer_),
+                  [self](const error_code& ec, std::size_t bytes_transferred) {
+                      if (ec)
+                      {
+                          CROW_LOG_DEBUG << self.get() << " HTTP/2 read: " << ec.message();
+                          self->close();
+                          return;
+                      }
+                      self->input_.append(self->read_buffer_.data(), bytes_transferred);
+                      self->process_input();
+                      if (!self->closing_)
+                          self->do_read();
+                      self->flush();
+                  });
+            }
+
+            /// Handle every complete frame in the input buffer.
+            void process_input()
+            {
+                size_t pos = 0;
+                if (!preface_received_)
+                {
+                    size_t n = std::min(input_.size(), connection_preface.size());
+                    if (input_.compare(0, n, connection_preface, 0, n) != 0)
+                    {
+                        goaway(error::protocol_error);
+                        return;
+                    }
+                    if (n < connection_preface.size())
+                        return;
+                    preface_received_ = true;
+                    pos = n;
+                }
+
+                while (!closing_ && input_.size() - pos >= 9)
+                {
+                    auto header = reinterpret_cast<const uint8_t*>(input_.data() + pos);
+                    uint32_t length = (header[0] << 16) | (header[1] << 8) | header[2];
+                    uint8_t type = header[3];
+                    uint8_t flags = header[4];
+                    uint32_t stream_id = read_u32(header + 5) & 0x7fffffff;
+                    if (length > max_frame_size)
+                    {
+                        goaway(error::frame_size_error);
+                        break;
+                    }
+                    if (input_.size() - pos - 9 < length)
+                        break;
+                    handle_frame(type, flags, stream_id, header + 9, length);
+                    pos += 9 + length;
+                }
+                input_.erase(0, pos);
+
+                if (received_data_ > 0 && !closing_)
+                {
+                    queue_window_update(0, received_data_);
+                    received_data_ = 0;
+                }
+            }
+
+            void handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, uint32_t length)
+            {
+                // A header block has to be finished before anything else on the connection.
+                if (header_block_stream_ && (type != CONTINUATION || stream_id != header_block_stream_))
+                {
+                    goaway(error::protocol_error);
+                    return;
+                }
+
+                switch (type)
+                {
+                    case DATA:
+                        handle_data(flags, stream_id, payload, length);
+                        break;
+                    case HEADERS:
+                        handle_headers(flags, stream_id, payload, length);
+                        break;
+                    case CONTINUATION:
+                        if (!header_block_stream_)
+                        {
+                            goaway(error::protocol_error);
+                            return;
+                        }
+                        if (header_block_.size() + length > max_header_block_size)
+                        {
+                            goaway(error::enhance_your_calm);
+                            return;
+                        }
+                        header_block_.append(reinterpret_cast<const char*>(payload), length);
+                        if (flags & END_HEADERS)
+                        {
+                            header_block_stream_ = 0;
+                            handle_header_block(stream_id, header_block_end_stream_);
+                        }
+                        break;
+                    case RST_STREAM:
+                        if (stream_id == 0)
+                            goaway(error::protocol_error);
+                        else if (length != 4)
+                            goaway(error::frame_size_error);
+                        else
+                            handle_reset(stream_id);
+                        break;
+                    case SETTINGS:
+                        if (stream_id != 0)
+                            goaway(error::protocol_error);
+                        else if ((flags & ACK) ? length != 0 : length % 6 != 0)
+                            goaway(error::frame_size_error);
+                        else if (!(flags & ACK))
+                        {
+                            error result = apply_settings(payload, length);
+                            if (result != error::no_error)
+                                goaway(result);
+                            else
+                                queue_frame(SETTINGS, ACK, 0, nullptr, 0);
+                        }
+                        break;
+                    case PING:
+                        if (stream_id != 0)
+                            goaway(error::protocol_error);
+                        else if (length != 8)
+                            goaway(error::frame_size_error);
+                        else if (!(flags & ACK))
+                            queue_frame(PING, ACK, 0, payload, length);
+                        break;
+                    case GOAWAY:
+                        if (stream_id != 0)
+                            goaway(error::protocol_error);
+                        else
+                            peer_going_away_ = true;
+                        break;
+                    case WINDOW_UPDATE:
+                        if (length != 4)
+                            goaway(error::frame_size_error);
+                        else
+                            handle_window_update(stream_id, read_u32(payload) & 0x7fffffff);
+                        break;
+                    case PUSH_PROMISE:
+                        goaway(error::protocol_error);
+                        break;
+                    default: // PRIORITY is advisory and unknown frame types are ignored
+                        break;
+                }
+            }
+
+            void handle_data(uint8_t flags, uint32_t stream_id, const uint8_t* payload, uint32_t length)
+            {
+                if (stream_id == 0)
+                {
+                    goaway(error::protocol_error);
+                    return;
+                }
+                // Padding counts against flow control too, for the connection and the stream.
+                uint32_t flow_controlled = length;
+                received_data_ += flow_controlled;
+                if (!strip_padding(flags, payload, length))
+                    return;
+
+                auto it = streams_.find(stream_id);
+                if (it == streams_.end() || it->second->remote_closed)
+                {
+                    if (stream_id > last_stream_id_)
+                        goaway(error::protocol_error);
+                    else
+                        queue_reset(stream_id, error::stream_closed);
+                    return;
+                }
+
+                auto& s = *it->second;
+                s.req.body.append(reinterpret_cast<const char*>(payload), length);
+                if (flags & END_STREAM)
+                {
+                    s.remote_closed = true;
+                    dispatch(s);
+                }
+                else if (flow_controlled > 0)
+                    queue_window_update(stream_id, flow_controlled);
+            }
+
+            void handle_headers(uint8_t flags, uint32_t stream_id, const uint8_t* payload, uint32_t length)
+            {
+                if (stream_id == 0 || stream_id % 2 == 0)
+                {
+                    goaway(error::protocol_error);
+                    return;
+                }
+                if (!strip_padding(flags, payload, length))
+                    return;
+                if (flags & PRIORITY_FLAG)
+                {
+                    if (length < 5)
+                    {
+                        goaway(error::frame_size_error);
+                        return;
+                    }
+                    payload += 5;
+                    length -= 5;
+                }
+
+                header_block_.assign(reinterpret_cast<const char*>(payload), length);
+                if (flags & END_HEADERS)
+                    handle_header_block(stream_id, flags & END_STREAM);
+                else
+                {
+                    header_block_stream_ = stream_id;
+                    header_block_end_stream_ = flags & END_STREAM;
+                }
+            }
+
+            /// A complete header block: a new request, or the trailers of one that is still being received.
+            void handle_header_block(uint32_t stream_id, bool end_stream)
+            {
+                std::vector<detail::hpack::header_field> fields;
+                // Even a block that is going to be refused has to be decoded, to keep the HPACK tables in step.
+                if (!decoder_.decode(reinterpret_cast<const uint8_t*>(header_block_.data()), header_block_.size(), fields))
+                {
+                    goaway(error::compression_error);
+                    return;
+                }
+                header_block_.clear();
+
+                auto it = streams_.find(stream_id);
+                if (it != streams_.end())
+                {
+                    auto& s = *it->second;
+                    if (s.remote_closed)
+                        queue_reset(stream_id, error::stream_closed);
+                    else if (!end_stream)
+                        goaway(error::protocol_error);
+                    else
+                    {
+                        // Trailers are accepted but not passed on.
+                        s.remote_closed = true;
+                        dispatch(s);
+                    }
+                    return;
+                }
+                if (stream_id <= last_stream_id_)
+                {
+                    goaway(error::protocol_error);
+                    return;
+                }
+                last_stream_id_ = stream_id;
+
+                if (streams_.size() >= CROW_HTTP2_MAX_CONCURRENT_STREAMS || peer_going_away_)
+                {
+                    queue_reset(stream_id, error::refused_stream);
+                    return;
+                }
+
+                auto& s = new_stream(stream_id);
+                if (!build_request(s.req, fields))
+                {
+                    streams_.erase(stream_id);
+                    queue_reset(stream_id, error::protocol_error);
+                    return;
+                }
+                if (end_stream)
+                {
+                    s.remote_closed = true;
+                    dispatch(s);
+                }
+            }
+
+            /// Turn a decoded header list into a request. Returns false if it is malformed.
+            bool build_request(request& req, std::vector<detail::hpack::header_field>& fields)
+            {
+                std::string method, path, cookie;
+                bool scheme = false, regular_seen = false;
+                for (auto& field : fields)
+                {
+                    if (std::any_of(field.name.begin(), field.name.end(), [](char c) {
+                            return std::isupper(static_cast<unsigned char>(c));
+                        }))
+                        return false;
+
+                    if (!field.name.empty() && field.name[0] == ':')
+                    {
+                        if (regular_seen)
+                            return false;
+                        if (field.name == ":method")
+                            method = std::move(field.value);
+                        else if (field.name == ":path")
+                            path = std::move(field.value);
+                        else if (field.name == ":scheme")
+                            scheme = true;
+                        else if (field.name == ":authority")
+                        {
+                            if (!req.headers.count("host"))
+                                req.headers.emplace("host", std::move(field.value));
+                        }
+                        else
+                            return false;
+                        continue;
+                    }
+
+                    regular_seen = true;
+                    if (field.name == "connection" || field.name == "keep-alive" || field.name == "proxy-connection" ||
+                        field.name == "transfer-encoding" || field.name == "upgrade")
+                        return false;
+                    // Cookies may be split into several fields, which are put back together (RFC 9113 section 8.2.3).
+                    if (field.name == "cookie")
+                    {
+                        cookie += cookie.empty() ? field.value : "; " + field.value;
+                        continue;
+                    }
+                    if (field.name == "host")
+                        req.headers.erase("host");
+                    req.headers.emplace(std::move(field.name), std::move(field.value));
+                }
+                if (!cookie.empty())
+                    req.headers.emplace("cookie", std::move(cookie));
+
+                if (method.empty() || path.empty() || !scheme || !parse_method(method, req.method))
+                    return false;
+                req.raw_url = std::move(path);
+                req.url_params = query_string(req.raw_url);
+                req.url = req.raw_url.substr(0, req.raw_url.find('?'));
+                req.http_ver_major = 2;
+                req.http_ver_minor = 0;
+                req.keep_alive = true;
+                req.close_connection = false;
+                req.upgrade = false;
+                return true;
+            }
+
+            static bool parse_method(const std::string& name, HTTPMethod& method)
+            {
+                for (int i = 0; i < static_cast<int>(HTTPMethod::InternalMethodCount); i++)
+                {
+                    if (method_name(static_cast<HTTPMethod>(i)) == name)
+                    {
+                        method = static_cast<HTTPMethod>(i);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            void handle_reset(uint32_t stream_id)
+            {
+                auto it = streams_.find(stream_id);
+                if (it == streams_.end())
+                {
+                    if (stream_id > last_stream_id_)
+                        goaway(error::protocol_error);
+                    return;
+                }
+                // A stream the app is still working on stays until it answers; the answer is then dropped.
+                if (it->second->in_flight)
+                    it->second->reset = true;
+                else
+                    streams_.erase(it);
+            }
+
+            void handle_window_update(uint32_t stream_id, uint32_t increment)
+            {
+                if (stream_id == 0)
+                {
+                    if (increment == 0 || send_window_ + increment > max_window_size)
+                        goaway(increment == 0 ? error::protocol_error : error::flow_control_error);
+                    else
+                        send_window_ += increment;
+                    return;
+                }
+                auto it = streams_.find(stream_id);
+                if (it == streams_.end())
+                    return;
+                if (increment == 0 || it->second->send_window + increment > max_window_size)
+                {
+                    queue_reset(stream_id, increment == 0 ? error::protocol_error : error::flow_control_error);
+                    cancel_stream(it);
+                    return;
+                }
+                it->second->send_window += increment;
+            }
+
+            /// Apply a SETTINGS payload from the client. Returns the connection error it causes, if any.
+            error apply_settings(const uint8_t* payload, size_t length)
+            {
+                for (size_t i = 0; i + 6 <= length; i += 6)
+                {
+                    uint16_t id = (payload[i] << 8) | payload[i + 1];
+                    uint32_t value = read_u32(payload + i + 2);
+                    switch (id)
+                    {
+                        case ENABLE_PUSH:
+                            if (value > 1)
+                                return error::protocol_error;
+                            break;
+                        case INITIAL_WINDOW_SIZE:
+                        {
+                            if (value > max_window_size)
+                                return error::flow_control_error;
+                            // The change applies to every open stream as well (RFC 9113 section 6.9.2).
+                            int64_t delta = static_cast<int64_t>(value) - initial_window_size_;
+                            initial_window_size_ = value;
+                            for (auto& kv : streams_)
+                            {
+                                kv.second->send_window += delta;
+                                if (kv.second->send_window > max_window_size)
+                                    return error::flow_control_error;
+                            }
+                            break;
+                        }
+                        case MAX_FRAME_SIZE:
+                            if (value < 16384 || value > 16777215)
+                                return error::protocol_error;
+                            peer_max_frame_size_ = value;
+                            break;
+                        default: // The encoder keeps no dynamic table, so HEADER_TABLE_SIZE doesn't matter either
+                            break;
+                    }
+                }
+                return error::no_error;
+            }
+
+            bool strip_padding(uint8_t flags, const uint8_t*& payload, uint32_t& length)
+            {
+                if (!(flags & PADDED))
+                    return true;
+                if (length < 1 || payload[0] >= length)
+                {
+                    goaway(error::protocol_error);
+                    return false;
+                }
+                length -= 1 + payload[0];
+                payload += 1;
+                return true;
+            }
+
+            stream_t& new_stream(uint32_t stream_id)
+            {
+                auto& s = streams_[stream_id];
+                s = std::make_shared<stream_t>();
+                s->id = stream_id;
+                s->send_window = initial_window_size_;
+                return *s;
+            }
+
+            /// Run a complete request through middleware and routing, exactly like \ref crow::Connection::handle().
+            void dispatch(stream_t& s)
+            {
+                cancel_deadline_timer();
+                s.in_flight = true;
+                load_.in_flight++;
+
+                request& req = s.req;
+                response& res = s.res;
+                req.middleware_context = static_cast<void*>(&s.ctx);
+                req.middleware_container = static_cast<void*>(middlewares_);
+                req.io_context = &adaptor_.get_io_context();
+                req.remote_ip_address = adaptor_.address();
+
+                CROW_LOG_INFO << "Request: " << utility::lexical_cast<std::string>(adaptor_.remote_endpoint()) << " " << this << " HTTP/2 stream " << s.id << ' ' << method_name(req.method) << " " << req.url;
+
+                s.routing = handler_->handle_initial(req, res);
+                if (!s.routing->rule_index)
+                {
+                    s.need_to_call_after_handlers = true;
+                    complete(s);
+                    return;
+                }
+
+                res.complete_request_handler_ = nullptr;
+                auto self = this->shared_from_this();
+                res.is_alive_helper_ = [self]() -> bool {
+                    return self->adaptor_.is_open();
+                };
+
+                detail::middleware_call_helper<detail::middleware_call_criteria_only_global,
+                                               0, decltype(s.ctx), decltype(*middlewares_)>({}, *middlewares_, req, res, s.ctx);
+
+                if (!res.completed_)
+                {
+                    // Holding the stream keeps `res` alive until response::end() returns, even if the stream is done by then.
+                    auto stream = streams_.at(s.id);
+                    res.complete_request_handler_ = [self, stream] {
+                        self->complete(*stream);
+                    };
+                    s.need_to_call_after_handlers = true;
+                    handler_->handle(req, res, s.routing);
+                }
+                else
+                    complete(s);
+            }
+
+            /// The app has answered a stream: queue the response headers and start sending the body.
+            void complete(stream_t& s)
+            {
+                request& req = s.req;
+                response& res = s.res;
+                CROW_LOG_INFO << "Response: " << this << " stream " << s.id << ' ' << req.raw_url << ' ' << res.code;
+                res.is_alive_helper_ = nullptr;
+                s.in_flight = false;
+                load_.in_flight--;
+
+                if (s.need_to_call_after_handlers)
+                {
+                    s.need_to_call_after_handlers = false;
+                    detail::after_handlers_call_helper<
+                      detail::middleware_call_criteria_only_global,
+                      (static_cast<int>(sizeof...(Middlewares)) - 1),
+                      decltype(s.ctx),
+                      decltype(*middlewares_)>({}, *middlewares_, s.ctx, req, res);
+                }
+#ifdef CROW_ENABLE_COMPRESSION
+                compression::compress_response(*handler_, req, res);
+#endif
+
+                // The stream itself is only dropped by flush().
+                if (s.reset || closing_ || !adaptor_.is_open())
+                {
+                    s.reset = true;
+                    schedule_flush();
+                    return;
+                }
+
+                if (res.is_static_type())
+                {
+                    if (res.file_info.asset)
+                        use_static_asset(s);
+                    else
+                        s.file = res.file_info.file;
+                }
+                else
+                    s.body.swap(res.body);
+                if (req.method == HTTPMethod::Head)
+                {
+                    s.body.clear();
+                    s.shared_body.reset();
+                    s.file.reset();
+                }
+
+                std::string block;
+                detail::hpack::encoder::encode(":status", std::to_string(res.code), block);
+                for (auto& kv : res.headers)
+                {
+                    std::string name = kv.first;
+                    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) {
+                        return std::tolower(c);
+                    });
+                    // Connection-specific fields don't exist in HTTP/2 (RFC 9113 section 8.2.2).
+                    if (name == "connection" || name == "keep-alive" || name == "transfer-encoding" || name == "upgrade")
+                        continue;
+                    detail::hpack::encoder::encode(name, kv.second, block);
+                }
+                if (!res.manual_length_header && !res.headers.count("content-length"))
+                    detail::hpack::encoder::encode("content-length", std::to_string(s.body_size()), block);
+                if (!res.headers.count("server"))
+                    detail::hpack::encoder::encode("server", server_name_, block);
+                if (!res.headers.count("date"))
+                    detail::hpack::encoder::encode("date", detail::http_date::now(), block);
+
+                bool end_stream = s.body_size() == 0;
+                queue_header_block(s.id, block, end_stream);
+                s.responding = true;
+                s.end_stream_sent = end_stream;
+                schedule_flush();
+            }
+
+            /// Answer from the in-memory copy of a small static file, like \ref crow::Connection::use_static_asset().
+            void use_static_asset(stream_t& s)
+            {
+                auto& res = s.res;
+                const auto& asset = *res.file_info.asset;
+                const auto& variant = asset.pick(s.req.get_header_value("accept-encoding"));
+                res.set_header("ETag", variant.etag);
+                if (asset.has_encodings())
+                    res.set_header("Vary", "Accept-Encoding");
+
+                const std::string& if_none_match = s.req.get_header_value("if-none-match");
+                if (!if_none_match.empty() && (if_none_match == "*" || if_none_match.find(variant.etag) != std::string::npos))
+                {
+                    res.code = 304;
+                    res.headers.erase("Content-Length");
+                    res.manual_length_header = true;
+                    return;
+                }
+
+                if (!variant.encoding.empty())
+                    res.set_header("Content-Encoding", variant.encoding);
+                res.set_header("Content-Length", variant.content_length);
+                s.shared_body = variant.data;
+            }
+
+            /// Send the response body of a stream no more; the client isn't going to get it.
+            void cancel_stream(typename std::map<uint32_t, std::shared_ptr<stream_t>>::iterator it)
+            {
+                if (it->second->in_flight)
+                    it->second->reset = true;
+                else
+                    streams_.erase(it);
+            }
+
+            void schedule_flush()
+            {
+                if (flush_scheduled_)
+                    return;
+                flush_scheduled_ = true;
+                auto self = this->shared_from_this();
+                asio::post(adaptor_.get_io_context(), [self] {
+                    self->flush_scheduled_ = false;
+                    self->flush();
+                });
+            }
+
+            /// Write everything that is queued, plus as much response data as the flow control windows allow.
+            void flush()
+            {
+                if (writing_ || !adaptor_.is_open())
+                    return;
+
+                write_buffer_.clear();
+                write_buffer_.swap(pending_);
+
+                // One DATA frame per stream per round, so a large response doesn't hold up the others.
+                bool progress = true;
+                while (progress && !closing_ && send_window_ > 0 && write_buffer_.size() < write_batch_size)
+                {
+                    progress = false;
+                    for (auto& kv : streams_)
+                    {
+                        auto& s = *kv.second;
+                        if (!s.responding || s.end_stream_sent || s.reset || s.send_window <= 0 || send_window_ <= 0)
+                            continue;
+                        uint64_t remaining = s.body_size() - s.sent;
+                        size_t n = static_cast<size_t>(std::min<uint64_t>({remaining, peer_max_frame_size_, static_cast<uint64_t>(s.send_window), static_cast<uint64_t>(send_window_)}));
+                        bool last = n == remaining;
+                        size_t header_at = write_buffer_.size();
+                        write_frame_header(write_buffer_, static_cast<uint32_t>(n), DATA, last ? END_STREAM : 0, s.id);
+                        if (s.file)
+                        {
+                            write_buffer_.resize(header_at + 9 + n);
+                            if (s.file->read(&write_buffer_[header_at + 9], n, s.sent) != n)
+                            {
+                                // The file changed under us; this stream can't be completed.
+                                write_buffer_.resize(header_at);
+                                s.reset = true;
+                                queue_reset(s.id, error::internal_error);
+                                continue;
+                            }
+                        }
+                        else
+                        {
+                            const std::string& body = s.shared_body ? *s.shared_body : s.body;
+                            write_buffer_.append(body, static_cast<size_t>(s.sent), n);
+                        }
+                        s.sent += n;
+                        s.send_window -= n;
+                        send_window_ -= n;
+                        s.end_stream_sent = last;
+                        progress = true;
+                    }
+                }
+                reap_streams();
+                write_buffer_ += pending_;
+                pending_.clear();
+
+                if (write_buffer_.empty())
+                {
+                    if (closing_ || (peer_going_away_ && streams_.empty()))
+                        close();
+                    else if (streams_.empty())
+                        start_deadline();
+                    return;
+                }
+
+                writing_ = true;
+                auto self = this->shared_from_this();
+                asio::async_write(
+                  adaptor_.socket(), asio::buffer(write_buffer_),
+                  [self](const error_code& ec, std::size_t /*bytes_transferred*/) {
+                      self->writing_ = false;
+                      if (ec)
+                      {
+                          CROW_LOG_DEBUG << self.get() << " HTTP/2 write: " << ec.message();
+                          self->close();
+                          return;
+                      }
+                      self->flush();
+                  });
+            }
+
+            /// Drop streams that are finished both ways, or cancelled and no longer with the app.
+            void reap_streams()
+            {
+                for (auto it = streams_.begin(); it != streams_.end();)
+                {
+                    auto& s = *it->second;
+                    if (s.in_flight)
+                        ++it;
+                    else if (s.reset)
+                        it = streams_.erase(it);
+                    else if (s.end_stream_sent)
+                    {
+                        // Answered before the request body was complete: the rest of it isn't needed.
+                        if (!s.remote_closed)
+                            queue_reset(s.id, error::no_error);
+                        it = streams_.erase(it);
+                    }
+                    else
+                        ++it;
+                }
+            }
+
+            void queue_settings()
+            {
+                uint8_t payload[12];
+                write_u16(payload, MAX_CONCURRENT_STREAMS);
+                write_u32(payload + 2, CROW_HTTP2_MAX_CONCURRENT_STREAMS);
+                write_u16(payload + 6, MAX_HEADER_LIST_SIZE);
+                write_u32(payload + 8, static_cast<uint32_t>(max_header_list_size));
+                queue_frame(SETTINGS, 0, 0, payload, sizeof(payload));
+            }
+
+            void queue_header_block(uint32_t stream_id, const std::string& block, bool end_stream)
+            {
+                size_t pos = 0;
+                uint8_t type = HEADERS;
+                do
+                {
+                    size_t n = std::min<size_t>(block.size() - pos, peer_max_frame_size_);
+                    uint8_t flags = (pos + n == block.size() ? END_HEADERS : 0) | (type == HEADERS && end_stream ? END_STREAM : 0);
+                    queue_frame(type, flags, stream_id, reinterpret_cast<const uint8_t*>(block.data() + pos), n);
+                    pos += n;
+                    type = CONTINUATION;
+                } while (pos < block.size());
+            }
+
+            void queue_window_update(uint32_t stream_id, uint32_t increment)
+            {
+                uint8_t payload[4];
+                write_u32(payload, increment);
+                queue_frame(WINDOW_UPDATE, 0, stream_id, payload, sizeof(payload));
+            }
+
+            void queue_reset(uint32_t stream_id, error code)
+            {
+                uint8_t payload[4];
+                write_u32(payload, static_cast<uint32_t>(code));
+                queue_frame(RST_STREAM, 0, stream_id, payload, sizeof(payload));
+            }
+
+            void queue_frame(uint8_t type, uint8_t flags, uint32_t stream_id, const uint8_t* payload, size_t length)
+            {
+                write_frame_header(pending_, static_cast<uint32_t>(length), type, flags, stream_id);
+                if (length > 0)
+                    pending_.append(reinterpret_cast<const char*>(payload), length);
+            }
+
+            /// Tell the client the connection is done (after `last_stream_id_`) and close it once that is written.
+            void goaway(error code)
+            {
+                if (closing_)
+                    return;
+                CROW_LOG_DEBUG << this << " HTTP/2 GOAWAY " << static_cast<uint32_t>(code);
+                closing_ = true;
+                uint8_t payload[8];
+                write_u32(payload, last_stream_id_);
+                write_u32(payload + 4, static_cast<uint32_t>(code));
+                queue_frame(GOAWAY, 0, 0, payload, sizeof(payload));
+            }
+
+            void close()
+            {
+                cancel_deadline_timer();
+                adaptor_.shutdown_readwrite();
+                adaptor_.close();
+            }
+
+            void cancel_deadline_timer()
+            {
+                task_timer_.cancel(task_id_);
+            }
+
+            void start_deadline()
+            {
+                cancel_deadline_timer();
+                auto self = this->shared_from_this();
+                task_id_ = task_timer_.schedule([self] {
+                    if (self->adaptor_.is_open())
+                        self->close();
+                });
+            }
+
+            static void write_frame_header(std::string& out, uint32_t length, uint8_t type, uint8_t flags, uint32_t stream_id)
+            {
+                uint8_t header[9] = {static_cast<uint8_t>(length >> 16), static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length), type, flags};
+                write_u32(header + 5, stream_id);
+                out.append(reinterpret_cast<const char*>(header), sizeof(header));
+            }
+
+            static uint32_t read_u32(const uint8_t* p)
+            {
+                return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+            }
+
+            static void write_u16(uint8_t* p, uint16_t value)
+            {
+                p[0] = static_cast<uint8_t>(value >> 8);
+                p[1] = static_cast<uint8_t>(value);
+            }
+
+            static void write_u32(uint8_t* p, uint32_t value)
+            {
+                p[0] = static_cast<uint8_t>(value >> 24);
+                p[1] = static_cast<uint8_t>(value >> 16);
+                p[2] = static_cast<uint8_t>(value >> 8);
+                p[3] = static_cast<uint8_t>(value);
+            }
+
+        private:
+            Adaptor adaptor_;
+            Handler* handler_;
+            const std::string& server_name_;
+            std::tuple<Middlewares...>* middlewares_;
+            detail::task_timer& task_timer_;
+            detail::task_timer::identifier_type task_id_{};
+            detail::io_context_load& load_;
+
+            std::array<char, 16384> read_buffer_;
+            std::string input_;
+            bool preface_received_ = false;
+            detail::hpack::decoder decoder_{4096, max_header_list_size};
+            std::string header_block_;
+            uint32_t header_block_stream_ = 0; ///< Stream whose header block continues in CONTINUATION frames.
+            bool header_block_end_stream_ = false;
+            uint32_t received_data_ = 0;       ///< DATA bytes read since the last connection WINDOW_UPDATE.
+
+            std::map<uint32_t, std::shared_ptr<stream_t>> streams_;
+            uint32_t last_stream_id_ = 0;
+            int64_t send_window_ = default_window_size;
+            int64_t initial_window_size_ = default_window_size;
+            uint32_t peer_max_frame_size_ = max_frame_size;
+
+            std::string pending_;      ///< Frames queued for the next write.
+            std::string write_buffer_; ///< What is being written.
+            bool writing_ = false;
+            bool flush_scheduled_ = false;
+            bool closing_ = false;     ///< GOAWAY is queued; nothing more is read.
+            bool peer_going_away_ = false;
+        };
+    } // namespace http2
+} // namespace crow
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "crow/settings.h"
+
 #ifdef CROW_USE_BOOST
 #include <boost/asio.hpp>
 #else
@@ -11,19 +13,29 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cerrno>
+#include <charconv>
 #include <chrono>
+#include <cstring>
+#include <deque>
 #include <memory>
+#include <string_view>
 #include <vector>
 
 #include "crow/http_parser_merged.h"
 #include "crow/common.h"
 #include "crow/compression.h"
+#include "crow/connection_pool.h"
+#include "crow/file_cache.h"
+#include "crow/http2.h"
+#include "crow/http_date.h"
 #include "crow/http_response.h"
+#include "crow/load_balancer.h"
 #include "crow/logging.h"
 #include "crow/middleware.h"
 #include "crow/middleware_context.h"
 #include "crow/parser.h"
-#include "crow/settings.h"
+#include "crow/request_arena.h"
 #include "crow/socket_adaptors.h"
 #include "crow/task_timer.h"
 #include "crow/utility.h"
@@ -42,6 +54,80 @@ namespace crow
     static std::atomic<int> connectionCount;
 #endif
 
+    namespace detail
+    {
+        /// A response waiting in a connection's outbound queue, with everything it needs to outlive the request.
+        struct outbound_message
+        {
+            std::string head;                   ///< Status line and headers.
+            std::string body;                   ///< Moved out of the response, never copied.
+            std::shared_ptr<const std::string> shared_body; ///< Sent instead of `body`, e.g. a cached static asset.
+            std::size_t body_written = 0;       ///< Bytes of the body already sent.
+            std::shared_ptr<const cached_file> file; ///< Static file to send after the head.
+            uint64_t file_offset = 0;           ///< Next byte of the file to send.
+            uint64_t file_end = 0;              ///< One past the last byte of the file to send.
+            std::vector<char> chunk;            ///< Holds the file chunk being written, where sendfile can't be used.
+            bool head_written = false;
+            bool close_connection = false;
+
+            const std::string& payload() const
+            {
+                return shared_body ? *shared_body : body;
+            }
+        };
+
+        enum class byte_range
+        {
+            whole,
+            partial,
+            unsatisfiable
+        };
+
+        /// Parse a `Range` header of the form `bytes=first-last`, `bytes=first-` or `bytes=-suffix` for a `size` byte file.
+
+        ///
+        /// On `partial`, the part to send is [begin, end). Anything else, multiple ranges included, means the whole file.
+        inline byte_range parse_byte_range(std::string_view header, uint64_t size, uint64_t& begin, uint64_t& end)
+        {
+            constexpr std::string_view unit = "bytes=";
+            if (header.compare(0, unit.size(), unit) != 0 || header.find(',') != std::string_view::npos)
+                return byte_range::whole;
+            size_t dash = header.find('-', unit.size());
+            if (dash == std::string_view::npos)
+                return byte_range::whole;
+
+            auto number = [&header](size_t from, size_t to, uint64_t& value) {
+                auto result = std::from_chars(header.data() + from, header.data() + to, value);
+                return from < to && result.ec == std::errc() && result.ptr == header.data() + to;
+            };
+            uint64_t first = 0, last = 0;
+            bool has_first = number(unit.size(), dash, first);
+            bool has_last = number(dash + 1, header.size(), last);
+            if ((!has_first && dash != unit.size()) || (!has_last && dash + 1 != header.size()))
+                return byte_range::whole;
+
+            if (has_first)
+            {
+                if (has_last && last < first)
+                    return byte_range::whole;
+                if (first >= size)
+                    return byte_range::unsatisfiable;
+                begin = first;
+                end = has_last ? std::min(last, size - 1) + 1 : size;
+            }
+            else if (has_last)
+            {
+                if (last == 0 || size == 0)
+                    return byte_range::unsatisfiable;
+                begin = size - std::min(last, size);
+                end = size;
+            }
+            else
+                return byte_range::whole;
+            return byte_range::partial;
+        }
+    } // namespace detail
+
     /// An HTTP connection.
     template<typename Adaptor, typename Handler, typename... Middlewares>
     class Connection : public std::enable_shared_from_this<Connection<Adaptor, Handler, Middlewares...>>
@@ -54,20 +140,20 @@ namespace crow
           Handler* handler,
           const std::string& server_name,
           std::tuple<Middlewares...>* middlewares,
-          std::function<std::string()>& get_cached_date_str_f,
           detail::task_timer& task_timer,
-          typename Adaptor::context* adaptor_ctx_,
-          std::atomic<unsigned int>& queue_length):
-          adaptor_(io_context, adaptor_ctx_),
+          typename Adaptor::context* adaptor_ctx,
+          detail::io_context_load& load):
+          adaptor_(io_context, adaptor_ctx),
+          io_context_(io_context),
+          adaptor_ctx_(adaptor_ctx),
           handler_(handler),
-          parser_(this),
+          parser_(this, &arena_),
           req_(parser_.req),
           server_name_(server_name),
           middlewares_(middlewares),
-          get_cached_date_str(get_cached_date_str_f),
           task_timer_(task_timer),
           res_stream_threshold_(handler->stream_threshold()),
-          queue_length_(queue_length)
+          load_(load)
         {
 #ifdef CROW_ENABLE_DEBUG
             connectionCount++;
@@ -77,12 +163,58 @@ namespace crow
 
         ~Connection()
         {
+            release_load();
 #ifdef CROW_ENABLE_DEBUG
             connectionCount--;
             CROW_LOG_DEBUG << "Connection (" << this << ") freed, total: " << connectionCount;
 #endif
         }
 
+        /// Give back the load of a connection that is done and forget its client, keeping the memory it has allocated.
+
+        ///
+        /// Called by the \ref detail::connection_pool once nothing refers to the connection anymore, instead of
+        /// destroying it. Request and response bodies are released, buffers and queues keep their capacity.
+        void recycle()
+        {
+            release_load();
+            adaptor_.close();
+            adaptor_ = Adaptor(io_context_, adaptor_ctx_);
+            read_buffer_.reset(); // This may not be the io thread, so it doesn't go back to that thread's pool.
+            parser_.reset();
+            arena_.reset();
+            routing_handle_result_.reset();
+            res = response();
+            close_connection_ = false;
+            head_.clear();
+            outbound_.clear();
+            write_buffers_.clear();
+            write_body_bytes_ = 0;
+            write_file_bytes_ = 0;
+            write_batched_ = 0;
+            file_range_begin_ = 0;
+            file_range_end_ = 0;
+            static_body_.reset();
+            unparsed_begin_ = 0;
+            unparsed_end_ = 0;
+            outbound_bytes_ = 0;
+            writing_ = false;
+            read_paused_ = false;
+            task_id_ = 0;
+            need_to_call_after_handlers_ = false;
+            need_to_start_read_after_complete_ = false;
+            add_keep_alive_ = false;
+            first_read_ = true;
+            upgrade_to_http2_ = false;
+            ctx_ = detail::context<Middlewares...>();
+        }
+
+        /// Start counting a recycled connection again, for the client it is about to accept.
+        void reuse()
+        {
+            counted_ = true;
+        }
+
         /// The TCP socket on top of which the connection is established.
         decltype(std::declval<Adaptor>().raw_socket())& socket()
         {
@@ -124,11 +256,12 @@ namespace crow
             // HTTP 1.1 Expect: 100-continue
             if (req_.http_ver_major == 1 && req_.http_ver_minor == 1 && get_header_value(req_.headers, "expect") == "100-continue")
             {
-                continue_requested = true;
-                buffers_.clear();
                 static std::string expect_100_continue = "HTTP/1.1 100 Continue\r\n\r\n";
-                buffers_.emplace_back(expect_100_continue.data(), expect_100_continue.size());
-                do_write_sync(buffers_);
+                detail::outbound_message message;
+                message.head = expect_100_continue;
+                outbound_bytes_ += message.head.size();
+                outbound_.push_back(std::move(message));
+                do_write();
             }
         }
 
@@ -138,6 +271,8 @@ namespace crow
             cancel_deadline_timer();
             bool is_invalid_request = false;
             add_keep_alive_ = false;
+            in_flight_ = true;
+            load_.in_flight++;
 
             // Create context
             ctx_ = detail::context<Middlewares...>();
@@ -145,7 +280,7 @@ namespace crow
             req_.middleware_container = static_cast<void*>(middlewares_);
             req_.io_context = &adaptor_.get_io_context();
 
-            req_.remote_ip_address = adaptor_.remote_endpoint().address().to_string();
+            req_.remote_ip_address = adaptor_.address();
 
             add_keep_alive_ = req_.keep_alive;
             close_connection_ = req_.close_connection;
@@ -162,8 +297,7 @@ namespace crow
                     // h2 or h2c headers
                     if (req_.get_header_value("upgrade").find("h2")==0)
                     {
-                        // TODO(ipkn): HTTP/2
-                        // currently, ignore upgrade header
+                        // Not flagged as an upgrade by the parser; h2c is handled below
                     }
                     else
                     {
@@ -175,6 +309,15 @@ namespace crow
                         return;
                     }
                 }
+                else if (req_.get_header_value("upgrade") == "h2c" && req_.headers.count("http2-settings") && !handler_->ssl_used() && outbound_.empty())
+                {
+                    // Cleartext HTTP/2 (RFC 7540 section 3.2), once any earlier responses are out of the way. The body
+                    // has been read as HTTP/1.1; parsing stops here and the rest goes to the HTTP/2 connection.
+                    // h2 needs TLS with ALPN, so such requests are simply answered over HTTP/1.1.
+                    upgrade_to_http2_ = true;
+                    parser_.pause();
+                    return;
+                }
             }
 
             CROW_LOG_INFO << "Request: " << utility::lexical_cast<std::string>(adaptor_.remote_endpoint()) << " " << this << " HTTP/" << (char)(req_.http_ver_major + '0') << "." << (char)(req_.http_ver_minor + '0') << ' ' << method_name(req_.method) << " " << req_.url;
@@ -201,6 +344,9 @@ namespace crow
                     handler_->handle(req_, res, routing_handle_result_);
                     if (add_keep_alive_)
                         res.set_header("connection", "Keep-Alive");
+                    // The parser holds this request until it is answered, so pipelined ones have to wait.
+                    if (need_to_call_after_handlers_)
+                        parser_.pause();
                 }
                 else
                 {
@@ -218,6 +364,11 @@ namespace crow
         {
             CROW_LOG_INFO << "Response: " << this << ' ' << req_.raw_url << ' ' << res.code << ' ' << close_connection_;
             res.is_alive_helper_ = nullptr;
+            if (in_flight_)
+            {
+                in_flight_ = false;
+                load_.in_flight--;
+            }
 
             if (need_to_call_after_handlers_)
             {
@@ -231,48 +382,28 @@ namespace crow
                   decltype(*middlewares_)>({}, *middlewares_, ctx_, req_, res);
             }
 #ifdef CROW_ENABLE_COMPRESSION
-            if (!res.body.empty() && handler_->compression_used())
-            {
-                std::string accept_encoding = req_.get_header_value("Accept-Encoding");
-                if (!accept_encoding.empty() && res.compressed)
-                {
-                    switch (handler_->compression_algorithm())
-                    {
-                        case compression::DEFLATE:
-                            if (accept_encoding.find("deflate") != std::string::npos)
-                            {
-                                res.body = compression::compress_string(res.body, compression::algorithm::DEFLATE);
-                                res.set_header("Content-Encoding", "deflate");
-                            }
-                            break;
-                        case compression::GZIP:
-                            if (accept_encoding.find("gzip") != std::string::npos)
-                            {
-                                res.body = compression::compress_string(res.body, compression::algorithm::GZIP);
-                                res.set_header("Content-Encoding", "gzip");
-                            }
-                            break;
-                        default:
-                            break;
-                    }
-                }
-            }
+            compression::compress_response(*handler_, req_, res);
 #endif
 
-            prepare_buffers();
-
             if (res.is_static_type())
             {
-                do_write_static();
-            }
-            else
-            {
-                do_write_general();
+                if (res.file_info.asset && !req_.headers.count("range"))
+                    use_static_asset();
+                else
+                    apply_static_range();
             }
+
+            prepare_head();
+            queue_response();
         }
 
     private:
-        void prepare_buffers()
+        /// Write the status line and headers of `res` into `head_`, one append after another.
+
+        ///
+        /// `head_` is the string of an earlier response's head, handed back by finish_message() once it was sent, so it
+        /// rarely needs to grow. The head then goes out with the body as two buffers of one write.
+        void prepare_head()
         {
             res.complete_request_handler_ = nullptr;
             res.is_alive_helper_ = nullptr;
@@ -283,287 +414,572 @@ namespace crow
                 //delete this;
                 return;
             }
-            // TODO(EDev): HTTP version in status codes should be dynamic
-            // Keep in sync with common.h/status
-            static std::unordered_map<int, std::string> statusCodes = {
-              {status::CONTINUE, "HTTP/1.1 100 Continue\r\n"},
-              {status::SWITCHING_PROTOCOLS, "HTTP/1.1 101 Switching Protocols\r\n"},
-
-              {status::OK, "HTTP/1.1 200 OK\r\n"},
-              {status::CREATED, "HTTP/1.1 201 Created\r\n"},
-              {status::ACCEPTED, "HTTP/1.1 202 Accepted\r\n"},
-              {status::NON_AUTHORITATIVE_INFORMATION, "HTTP/1.1 203 Non-Authoritative Information\r\n"},
-              {status::NO_CONTENT, "HTTP/1.1 204 No Content\r\n"},
-              {status::RESET_CONTENT, "HTTP/1.1 205 Reset Content\r\n"},
-              {status::PARTIAL_CONTENT, "HTTP/1.1 206 Partial Content\r\n"},
-
-              {status::MULTIPLE_CHOICES, "HTTP/1.1 300 Multiple Choices\r\n"},
-              {status::MOVED_PERMANENTLY, "HTTP/1.1 301 Moved Permanently\r\n"},
-              {status::FOUND, "HTTP/1.1 302 Found\r\n"},
-              {status::SEE_OTHER, "HTTP/1.1 303 See Other\r\n"},
-              {status::NOT_MODIFIED, "HTTP/1.1 304 Not Modified\r\n"},
-              {status::TEMPORARY_REDIRECT, "HTTP/1.1 307 Temporary Redirect\r\n"},
-              {status::PERMANENT_REDIRECT, "HTTP/1.1 308 Permanent Redirect\r\n"},
-
-              {status::BAD_REQUEST, "HTTP/1.1 400 Bad Request\r\n"},
-              {status::UNAUTHORIZED, "HTTP/1.1 401 Unauthorized\r\n"},
-              {status::FORBIDDEN, "HTTP/1.1 403 Forbidden\r\n"},
-              {status::NOT_FOUND, "HTTP/1.1 404 Not Found\r\n"},
-              {status::METHOD_NOT_ALLOWED, "HTTP/1.1 405 Method Not Allowed\r\n"},
-              {status::NOT_ACCEPTABLE, "HTTP/1.1 406 Not Acceptable\r\n"},
-              {status::PROXY_AUTHENTICATION_REQUIRED, "HTTP/1.1 407 Proxy Authentication Required\r\n"},
-              {status::CONFLICT, "HTTP/1.1 409 Conflict\r\n"},
-              {status::GONE, "HTTP/1.1 410 Gone\r\n"},
-              {status::PAYLOAD_TOO_LARGE, "HTTP/1.1 413 Payload Too Large\r\n"},
-              {status::UNSUPPORTED_MEDIA_TYPE, "HTTP/1.1 415 Unsupported Media Type\r\n"},
-              {status::RANGE_NOT_SATISFIABLE, "HTTP/1.1 416 Range Not Satisfiable\r\n"},
-              {status::EXPECTATION_FAILED, "HTTP/1.1 417 Expectation Failed\r\n"},
-              {status::PRECONDITION_REQUIRED, "HTTP/1.1 428 Precondition Required\r\n"},
-              {status::TOO_MANY_REQUESTS, "HTTP/1.1 429 Too Many Requests\r\n"},
-              {status::UNAVAILABLE_FOR_LEGAL_REASONS, "HTTP/1.1 451 Unavailable For Legal Reasons\r\n"},
-
-              {status::INTERNAL_SERVER_ERROR, "HTTP/1.1 500 Internal Server Error\r\n"},
-              {status::NOT_IMPLEMENTED, "HTTP/1.1 501 Not Implemented\r\n"},
-              {status::BAD_GATEWAY, "HTTP/1.1 502 Bad Gateway\r\n"},
-              {status::SERVICE_UNAVAILABLE, "HTTP/1.1 503 Service Unavailable\r\n"},
-              {status::GATEWAY_TIMEOUT, "HTTP/1.1 504 Gateway Timeout\r\n"},
-              {status::VARIANT_ALSO_NEGOTIATES, "HTTP/1.1 506 Variant Also Negotiates\r\n"},
-            };
-
-            static const std::string seperator = ": ";
 
-            buffers_.clear();
-            buffers_.reserve(4 * (res.headers.size() + 5) + 3);
-
-            if (!statusCodes.count(res.code))
+            std::string_view status = detail::status_line(res.code);
+            if (status.empty())
             {
                 CROW_LOG_WARNING << this << " status code "
                                  << "(" << res.code << ")"
                                  << " not defined, returning 500 instead";
                 res.code = 500;
+                status = detail::status_line(res.code);
             }
 
-            auto& status = statusCodes.find(res.code)->second;
-            buffers_.emplace_back(status.data(), status.size());
-
             if (res.code >= 400 && res.body.empty())
-                res.body = statusCodes[res.code].substr(9);
+                res.body = status.substr(9);
 
+            head_.clear();
+            head_.append(status);
+
+            bool has_content_length = res.manual_length_header, has_server = false, has_date = false;
             for (auto& kv : res.headers)
             {
-                buffers_.emplace_back(kv.first.data(), kv.first.size());
-                buffers_.emplace_back(seperator.data(), seperator.size());
-                buffers_.emplace_back(kv.second.data(), kv.second.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                head_.append(kv.first).append(": ", 2).append(kv.second).append("\r\n", 2);
+                // The only names that can match are the headers Crow adds itself.
+                switch (kv.first.size())
+                {
+                    case 4: has_date = has_date || utility::string_equals(kv.first, "date"); break;
+                    case 6: has_server = has_server || utility::string_equals(kv.first, "server"); break;
+                    case 14: has_content_length = has_content_length || utility::string_equals(kv.first, "content-length"); break;
+                }
             }
 
-            if (!res.manual_length_header && !res.headers.count("content-length"))
+            if (!has_content_length)
             {
-                content_length_ = std::to_string(res.body.size());
-                static std::string content_length_tag = "Content-Length: ";
-                buffers_.emplace_back(content_length_tag.data(), content_length_tag.size());
-                buffers_.emplace_back(content_length_.data(), content_length_.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                char length[20];
+                auto end = std::to_chars(length, length + sizeof(length), res.body.size()).ptr;
+                head_.append("Content-Length: ", 16).append(length, end - length).append("\r\n", 2);
             }
-            if (!res.headers.count("server"))
+            if (!has_server)
+                head_.append("Server: ", 8).append(server_name_).append("\r\n", 2);
+            if (!has_date)
+                head_.append("Date: ", 6).append(detail::http_date::now()).append("\r\n", 2);
+            if (add_keep_alive_)
+                head_.append("Connection: Keep-Alive\r\n", 24);
+
+            head_.append("\r\n", 2);
+        }
+
+        /// Answer from the in-memory copy of a small static file, in the best encoding the client accepts.
+        void use_static_asset()
+        {
+            const auto& asset = *res.file_info.asset;
+            const auto& variant = asset.pick(req_.get_header_value("accept-encoding"));
+            res.set_header("ETag", variant.etag);
+            if (asset.has_encodings())
+                res.set_header("Vary", "Accept-Encoding");
+
+            const std::string& if_none_match = req_.get_header_value("if-none-match");
+            if (!if_none_match.empty() && (if_none_match == "*" || if_none_match.find(variant.etag) != std::string::npos))
             {
-                static std::string server_tag = "Server: ";
-                buffers_.emplace_back(server_tag.data(), server_tag.size());
-                buffers_.emplace_back(server_name_.data(), server_name_.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                res.code = 304;
+                res.headers.erase("Content-Length");
+                res.manual_length_header = true;
+                res.file_info = response::static_file_info{};
+                return;
             }
-            if (!res.headers.count("date"))
+
+            if (!variant.encoding.empty())
+                res.set_header("Content-Encoding", variant.encoding);
+            res.set_header("Content-Length", variant.content_length);
+            static_body_ = variant.data;
+        }
+
+        /// Answer a `Range` request for a static file with 206 and just that part, or 416 if it starts past the end.
+        void apply_static_range()
+        {
+            uint64_t size = res.file_info.statbuf.st_size;
+            file_range_begin_ = 0;
+            file_range_end_ = size;
+
+            // An If-Range can't be validated without an ETag, so it gets the whole file, as RFC 9110 allows.
+            const std::string& range = req_.get_header_value("range");
+            if (range.empty() || res.code != 200 || req_.headers.count("if-range"))
+                return;
+
+            switch (detail::parse_byte_range(range, size, file_range_begin_, file_range_end_))
             {
-                static std::string date_tag = "Date: ";
-                date_str_ = get_cached_date_str();
-                buffers_.emplace_back(date_tag.data(), date_tag.size());
-                buffers_.emplace_back(date_str_.data(), date_str_.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                case detail::byte_range::partial:
+                    res.code = 206;
+                    res.set_header("Content-Length", std::to_string(file_range_end_ - file_range_begin_));
+                    res.set_header("Content-Range", "bytes " + std::to_string(file_range_begin_) + '-' + std::to_string(file_range_end_ - 1) + '/' + std::to_string(size));
+                    break;
+                case detail::byte_range::unsatisfiable:
+                    res.code = 416;
+                    res.headers.erase("Content-Length");
+                    res.headers.erase("Content-Type");
+                    res.set_header("Content-Range", "bytes */" + std::to_string(size));
+                    res.file_info = response::static_file_info{};
+                    break;
+                default:
+                    break;
             }
-            if (add_keep_alive_)
+        }
+
+        /// Move the response into the outbound queue and get ready for the next request.
+        void queue_response()
+        {
+            if (adaptor_.is_open())
             {
-                static std::string keep_alive_tag = "Connection: Keep-Alive";
-                buffers_.emplace_back(keep_alive_tag.data(), keep_alive_tag.size());
-                buffers_.emplace_back(crlf.data(), crlf.size());
+                detail::outbound_message message;
+                message.head.swap(head_);
+                if (res.is_static_type())
+                {
+                    if (req_.method != HTTPMethod::Head)
+                    {
+                        if (static_body_)
+                            message.shared_body = std::move(static_body_);
+                        else
+                        {
+                            message.file = res.file_info.file;
+                            message.file_offset = file_range_begin_;
+                            message.file_end = file_range_end_;
+                            if (!Adaptor::can_sendfile)
+                                message.chunk.resize(write_chunk_size);
+                        }
+                    }
+                }
+                else
+                    message.body.swap(res.body);
+                message.close_connection = close_connection_;
+
+                outbound_bytes_ += message.head.size() + message.payload().size();
+                outbound_.push_back(std::move(message));
             }
 
-            buffers_.emplace_back(crlf.data(), crlf.size());
+            res.clear();
+            static_body_.reset();
+            parser_.clear();
+            arena_.release();
+            if (outbound_bytes_ > CROW_OUTBOUND_HIGH_WATERMARK)
+                parser_.pause();
+
+            do_write();
+            if (need_to_start_read_after_complete_)
+            {
+                need_to_start_read_after_complete_ = false;
+                resume_reading();
+            }
         }
 
-        void do_write_static()
+        /// Parse the next pipelined request, or read more, unless this client has too many unsent responses queued already.
+
+        ///
+        /// Reading resumes once the queue drains below the low watermark (see \ref on_write()).
+        void resume_reading()
         {
-            asio::write(adaptor_.socket(), buffers_);
+            start_deadline();
+            if (outbound_bytes_ > CROW_OUTBOUND_HIGH_WATERMARK)
+            {
+                CROW_LOG_DEBUG << this << " paused reading, " << outbound_bytes_ << " bytes queued";
+                read_paused_ = true;
+                return;
+            }
+            if (unparsed_begin_ < unparsed_end_)
+                parse_buffered(unparsed_begin_, unparsed_end_);
+            else
+                do_read();
+        }
+
+        /// Read the next bytes from the client.
 
-            if (res.file_info.statResult == 0)
+        ///
+        /// On a plain socket this only waits until it is readable, and a read buffer is borrowed from the io thread's
+        /// pool once data is there. TLS keeps its own buffers, and readiness of the socket says nothing about what it
+        /// has decrypted already, so there the buffer is held during the read.
+        void do_read()
+        {
+            auto self = this->shared_from_this();
+            if constexpr (Adaptor::can_sendfile)
             {
-                std::ifstream is(res.file_info.path.c_str(), std::ios::in | std::ios::binary);
-                std::vector<asio::const_buffer> buffers{1};
-                char buf[16384];
-                is.read(buf, sizeof(buf));
-                while (is.gcount() > 0)
-                {
-                    buffers[0] = asio::buffer(buf, is.gcount());
-                    do_write_sync(buffers);
-                    is.read(buf, sizeof(buf));
-                }
+                release_read_buffer();
+                arena_.trim();
+                adaptor_.raw_socket().async_wait(asio::socket_base::wait_read, [self](const error_code& ec) {
+                    if (!ec)
+                        self->read_available();
+                    else
+                        self->close_after_read();
+                });
             }
-            if (close_connection_)
+            else
             {
-                adaptor_.shutdown_readwrite();
-                adaptor_.close();
-                CROW_LOG_DEBUG << this << " from write (static)";
+                if (!read_buffer_)
+                    read_buffer_ = detail::read_buffer_pool::local().acquire();
+                adaptor_.socket().async_read_some(
+                  asio::buffer(*read_buffer_),
+                  [self](const error_code& ec, std::size_t bytes_transferred) {
+                      if (!ec)
+                          self->parse_buffered(0, bytes_transferred);
+                      else
+                          self->close_after_read();
+                  });
             }
+        }
 
-            res.end();
-            res.clear();
-            buffers_.clear();
-            parser_.clear();
+        /// Read what a readable plain socket has, into a buffer borrowed for it.
+        void read_available()
+        {
+            auto& socket = adaptor_.raw_socket();
+            error_code ec;
+            if (!socket.non_blocking())
+                socket.non_blocking(true, ec);
+            read_buffer_ = detail::read_buffer_pool::local().acquire();
+            std::size_t bytes_transferred = ec ? 0 : socket.read_some(asio::buffer(*read_buffer_), ec);
+            if (ec == asio::error::would_block || ec == asio::error::try_again)
+                do_read();
+            else if (ec)
+                close_after_read();
+            else
+                parse_buffered(0, bytes_transferred);
         }
 
-        void do_write_general()
+        void release_read_buffer()
         {
-            if (res.body.length() < res_stream_threshold_)
+            if (read_buffer_)
+                detail::read_buffer_pool::local().release(std::move(read_buffer_));
+        }
+
+        /// Stop reading after the client closed its side, a read failed or a request couldn't be parsed.
+
+        ///
+        /// Responses to the requests before that still go out: the connection is closed after the last of them, or
+        /// right away if there is none.
+        void close_after_read()
+        {
+            release_read_buffer();
+            parser_.done();
+            adaptor_.shutdown_read();
+            need_to_start_read_after_complete_ = false;
+            CROW_LOG_DEBUG << this << " from read(1) with description: \"" << http_errno_description(static_cast<http_errno>(parser_.http_errno)) << '\"';
+            if (!adaptor_.is_open())
+            {
+                cancel_deadline_timer();
+                return;
+            }
+            if (in_flight_)
             {
-                res_body_copy_.swap(res.body);
-                buffers_.emplace_back(res_body_copy_.data(), res_body_copy_.size());
+                // complete_request() queues the last response.
+                close_connection_ = true;
+                return;
+            }
+            if (!outbound_.empty())
+            {
+                outbound_.back().close_connection = true;
+                return;
+            }
+            cancel_deadline_timer();
+            adaptor_.close();
+        }
 
-                do_write_sync(buffers_);
+        /// Parse the bytes in [begin, end) of the read buffer, which may hold several pipelined requests.
 
-                if (need_to_start_read_after_complete_)
+        ///
+        /// The parser stops early after a request whose response is still pending or overfills the outbound queue. The
+        /// bytes it didn't get to stay in the buffer and are parsed by \ref resume_reading() before anything new is read.
+        void parse_buffered(size_t begin, size_t end)
+        {
+            if (first_read_)
+            {
+                first_read_ = false;
+                static const std::string request_line = "PRI * HTTP/2.0\r\n";
+                if (end - begin >= request_line.size() && std::equal(request_line.begin(), request_line.end(), read_buffer_->data() + begin) && !handler_->ssl_used())
                 {
-                    need_to_start_read_after_complete_ = false;
-                    start_deadline();
-                    do_read();
+                    start_http2(begin, end);
+                    return;
                 }
             }
-            else
+
+            size_t parsed = 0;
+            auto started = std::chrono::steady_clock::now();
+            bool ret = parser_.feed(read_buffer_->data() + begin, end - begin, parsed);
+            load_.busy_ns.fetch_add(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count(),
+              std::memory_order_relaxed);
+            unparsed_begin_ = begin + parsed;
+            unparsed_end_ = end;
+            if (upgrade_to_http2_)
+            {
+                start_http2(unparsed_begin_, unparsed_end_);
+                return;
+            }
+            // The parser copied what it needs, so the buffer only has to stay while pipelined bytes wait in it.
+            if (unparsed_begin_ == unparsed_end_)
+                release_read_buffer();
+
+            if (!ret || !adaptor_.is_open())
+            {
+                close_after_read();
+            }
+            else if (close_connection_)
             {
-                asio::write(adaptor_.socket(), buffers_); // Write the response start / headers
                 cancel_deadline_timer();
-                if (res.body.length() > 0)
+                parser_.done();
+                // adaptor will close after write
+            }
+            else if (!need_to_call_after_handlers_)
+            {
+                resume_reading();
+            }
+            else
+            {
+                // res will be completed later by user
+                need_to_start_read_after_complete_ = true;
+            }
+        }
+
+        /// Hand the socket over to an HTTP/2 connection, with the bytes in [begin, end) of the read buffer still to be parsed.
+
+        ///
+        /// This connection goes away once the read that led here returns. On an upgrade, the request that asked for it
+        /// becomes stream 1.
+        void start_http2(size_t begin, size_t end)
+        {
+            cancel_deadline_timer();
+            auto connection = std::make_shared<http2::Connection<Adaptor, Handler, Middlewares...>>(
+              std::move(adaptor_), handler_, server_name_, middlewares_, task_timer_, load_);
+            if (upgrade_to_http2_)
+            {
+                std::string settings = req_.get_header_value("http2-settings");
+                connection->start_upgraded(std::move(req_), settings, read_buffer_->data() + begin, end - begin);
+            }
+            else
+                connection->start(read_buffer_->data() + begin, end - begin);
+            release_read_buffer();
+        }
+
+        /// Start writing the front of the outbound queue, unless a write is already in progress.
+
+        ///
+        /// Every write is asynchronous. A body below the stream threshold goes out with its head in one write, together
+        /// with small responses queued behind it. Larger bodies follow the head in chunks, one write each, straight from
+        /// the queued message. Static files go through sendfile on plain TCP, and are read into a chunk per write
+        /// otherwise (TLS).
+        void do_write()
+        {
+            while (!writing_ && !outbound_.empty())
+            {
+                auto& message = outbound_.front();
+                write_buffers_.clear();
+                write_body_bytes_ = 0;
+                write_file_bytes_ = 0;
+                write_batched_ = 0;
+
+                if (!message.head_written)
+                    write_buffers_.emplace_back(message.head.data(), message.head.size());
+                if (message.file)
                 {
-                    std::vector<asio::const_buffer> buffers{1};
-                    const uint8_t* data = reinterpret_cast<const uint8_t*>(res.body.data());
-                    size_t length = res.body.length();
-                    for (size_t transferred = 0; transferred < length;)
+                    if (message.file_offset < message.file_end)
                     {
-                        size_t to_transfer = CROW_MIN(16384UL, length - transferred);
-                        buffers[0] = asio::const_buffer(data + transferred, to_transfer);
-                        do_write_sync(buffers);
-                        transferred += to_transfer;
+#ifdef CROW_HAS_SENDFILE
+                        if (Adaptor::can_sendfile && message.head_written)
+                        {
+                            send_file(message);
+                            continue;
+                        }
+                        if (!Adaptor::can_sendfile)
+#endif
+                        {
+                            write_file_bytes_ = message.file->read(message.chunk.data(), CROW_MIN(message.chunk.size(), message.file_end - message.file_offset), message.file_offset);
+                            if (write_file_bytes_ == 0)
+                            {
+                                abort_writes("static file shrank while being sent");
+                                return;
+                            }
+                            write_buffers_.emplace_back(message.chunk.data(), write_file_bytes_);
+                        }
                     }
                 }
-                if (close_connection_)
+                else if (message.body_written < message.payload().size())
+                {
+                    const std::string& body = message.payload();
+                    size_t remaining = body.size() - message.body_written;
+                    write_body_bytes_ = body.size() < res_stream_threshold_ ? remaining : CROW_MIN(write_chunk_size, remaining);
+                    write_buffers_.emplace_back(body.data() + message.body_written, write_body_bytes_);
+                }
+                if (is_small(message))
+                    batch_small_messages();
+
+                if (write_buffers_.empty())
                 {
-                    adaptor_.shutdown_readwrite();
-                    adaptor_.close();
-                    CROW_LOG_DEBUG << this << " from write (res_stream)";
+                    finish_message();
+                    continue;
                 }
 
-                res.end();
-                res.clear();
-                buffers_.clear();
-                parser_.clear();
+                writing_ = true;
+                auto self = this->shared_from_this();
+                asio::async_write(
+                  adaptor_.socket(), write_buffers_,
+                  [self](const error_code& ec, std::size_t /*bytes_transferred*/) {
+                      self->on_write(ec);
+                  });
             }
         }
 
-        void do_read()
+        /// A response that goes out whole in a single write, head and body together.
+        bool is_small(const detail::outbound_message& message) const
         {
-            auto self = this->shared_from_this();
-            adaptor_.socket().async_read_some(
-              asio::buffer(buffer_),
-              [self](const error_code& ec, std::size_t bytes_transferred) {
-                  bool error_while_reading = true;
-                  if (!ec)
-                  {
-                      bool ret = self->parser_.feed(self->buffer_.data(), bytes_transferred);
-                      if (ret && self->adaptor_.is_open())
-                      {
-                          error_while_reading = false;
-                      }
-                  }
-
-                  if (error_while_reading)
-                  {
-                      self->cancel_deadline_timer();
-                      self->parser_.done();
-                      self->adaptor_.shutdown_read();
-                      self->adaptor_.close();
-                      CROW_LOG_DEBUG << self << " from read(1) with description: \"" << http_errno_description(static_cast<http_errno>(self->parser_.http_errno)) << '\"';
-                  }
-                  else if (self->close_connection_)
-                  {
-                      self->cancel_deadline_timer();
-                      self->parser_.done();
-                      // adaptor will close after write
-                  }
-                  else if (!self->need_to_call_after_handlers_)
-                  {
-                      self->start_deadline();
-                      self->do_read();
-                  }
-                  else
-                  {
-                      // res will be completed later by user
-                      self->need_to_start_read_after_complete_ = true;
-                  }
-              });
+            return !message.head_written && !message.file && message.payload().size() < res_stream_threshold_;
         }
 
-        void do_write()
+        /// Add the small responses queued behind the front one to the same write.
+
+        ///
+        /// Pipelined requests with short answers then cost one syscall (a single writev) between them, up to
+        /// `max_batched_messages` more responses or `max_batched_bytes` more bytes.
+        void batch_small_messages()
         {
-            auto self = this->shared_from_this();
-            asio::async_write(
-              adaptor_.socket(), buffers_,
-              [self](const error_code& ec, std::size_t /*bytes_transferred*/) {
-                  self->res.clear();
-                  self->res_body_copy_.clear();
-                  if (!self->continue_requested)
-                  {
-                      self->parser_.clear();
-                  }
-                  else
-                  {
-                      self->continue_requested = false;
-                  }
-
-                  if (!ec)
-                  {
-                      if (self->close_connection_)
-                      {
-                          self->adaptor_.shutdown_write();
-                          self->adaptor_.close();
-                          CROW_LOG_DEBUG << self << " from write(1)";
-                      }
-                  }
-                  else
-                  {
-                      CROW_LOG_DEBUG << self << " from write(2)";
-                  }
-              });
-        }
-
-        inline void do_write_sync(std::vector<asio::const_buffer>& buffers)
+            write_batched_ = 0;
+            size_t bytes = 0;
+            for (auto it = outbound_.begin(); !it->close_connection && ++it != outbound_.end();)
+            {
+                size_t size = it->head.size() + it->payload().size();
+                if (!is_small(*it) || write_batched_ == max_batched_messages || bytes + size > max_batched_bytes)
+                    break;
+                write_buffers_.emplace_back(it->head.data(), it->head.size());
+                if (!it->payload().empty())
+                    write_buffers_.emplace_back(it->payload().data(), it->payload().size());
+                bytes += size;
+                write_batched_++;
+            }
+        }
+
+#ifdef CROW_HAS_SENDFILE
+        /// Have the kernel send the next part of a static file from the page cache.
+
+        ///
+        /// Sends at most `sendfile_chunk_size` bytes before letting other connections on this io thread run, and
+        /// waits for the socket to drain when it is full.
+        void send_file(detail::outbound_message& message)
         {
+            auto& socket = adaptor_.raw_socket();
             error_code ec;
-            asio::write(adaptor_.socket(), buffers, ec);
+            if (!socket.native_non_blocking())
+                socket.native_non_blocking(true, ec);
+            if (ec)
+            {
+                abort_writes(ec.message());
+                return;
+            }
 
-            this->res.clear();
-            this->res_body_copy_.clear();
-            if (this->continue_requested)
+            off_t offset = static_cast<off_t>(message.file_offset);
+            size_t count = CROW_MIN(static_cast<uint64_t>(sendfile_chunk_size), message.file_end - message.file_offset);
+            ssize_t sent = ::sendfile(socket.native_handle(), message.file->fd, &offset, count);
+            if (sent < 0 && errno == EINTR)
+                return;
+            if (sent <= 0 && !(sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)))
             {
-                this->continue_requested = false;
+                abort_writes(sent == 0 ? std::string("static file shrank while being sent") : std::string(strerror(errno)));
+                return;
+            }
+
+            writing_ = true;
+            auto self = this->shared_from_this();
+            if (sent > 0)
+            {
+                message.file_offset += sent;
+                if (!in_flight_)
+                    start_deadline();
+                asio::post(adaptor_.get_io_context(), [self] {
+                    self->writing_ = false;
+                    self->do_write();
+                });
             }
             else
             {
-                this->parser_.clear();
+                socket.async_wait(asio::socket_base::wait_write, [self](const error_code& ec) {
+                    self->writing_ = false;
+                    if (ec)
+                        self->abort_writes(ec.message());
+                    else
+                        self->do_write();
+                });
             }
+        }
+#endif
+
+        /// Drop everything queued and close the connection; the client can't get a complete response any more.
+        void abort_writes(const std::string& reason)
+        {
+            CROW_LOG_DEBUG << this << " from write(2): " << reason;
+            outbound_.clear();
+            outbound_bytes_ = 0;
+            cancel_deadline_timer();
+            adaptor_.shutdown_readwrite();
+            adaptor_.close();
+        }
 
+        void on_write(const error_code& ec)
+        {
+            writing_ = false;
             if (ec)
             {
-                CROW_LOG_ERROR << ec << " - happened while sending buffers";
-                CROW_LOG_DEBUG << this << " from write (sync)(2)";
+                abort_writes(ec.message());
+                return;
+            }
+
+            auto& message = outbound_.front();
+            if (!message.head_written)
+            {
+                message.head_written = true;
+                outbound_bytes_ -= message.head.size();
             }
+            message.body_written += write_body_bytes_;
+            message.file_offset += write_file_bytes_;
+            outbound_bytes_ -= write_body_bytes_;
+            // Batched responses went out whole; do_write() pops them along with the front one.
+            for (size_t i = 1; i <= write_batched_; i++)
+            {
+                auto& batched = outbound_[i];
+                batched.head_written = true;
+                batched.body_written = batched.payload().size();
+                outbound_bytes_ -= batched.head.size() + batched.body_written;
+            }
+            write_batched_ = 0;
+
+            // The client is keeping up, so the idle timeout starts over (unless a handler is still working on a request).
+            if (!in_flight_)
+                start_deadline();
+
+            if (read_paused_ && outbound_bytes_ <= CROW_OUTBOUND_LOW_WATERMARK)
+            {
+                CROW_LOG_DEBUG << this << " resumed reading, " << outbound_bytes_ << " bytes queued";
+                read_paused_ = false;
+                resume_reading();
+            }
+            do_write();
+        }
+
+        /// The front message has been sent in full.
+        void finish_message()
+        {
+            bool close = outbound_.front().close_connection;
+            // Keep the string of the head for the next response's head.
+            if (head_.capacity() <= outbound_.front().head.capacity())
+                head_.swap(outbound_.front().head);
+            outbound_.pop_front();
+            if (close)
+            {
+                outbound_.clear();
+                outbound_bytes_ = 0;
+                cancel_deadline_timer();
+                adaptor_.shutdown_write();
+                adaptor_.close();
+                CROW_LOG_DEBUG << this << " from write(1)";
+            }
+        }
+
+        /// The connection counts towards its io thread's load from the accept until it is destroyed or recycled.
+        void release_load()
+        {
+            if (!counted_)
+                return;
+            counted_ = false;
+            if (in_flight_)
+            {
+                load_.in_flight--;
+                in_flight_ = false;
+            }
+            load_.connections--;
         }
 
         void cancel_deadline_timer()
@@ -590,10 +1006,15 @@ namespace crow
 
     private:
         Adaptor adaptor_;
+        asio::io_context& io_context_;
+        typename Adaptor::context* adaptor_ctx_;
         Handler* handler_;
 
-        std::array<char, 4096> buffer_;
+        /// Borrowed from the io thread's pool while there are received bytes to parse, see \ref do_read().
+        std::unique_ptr<detail::read_buffer_pool::buffer> read_buffer_;
 
+        /// Holds the headers of the request being parsed, see \ref detail::request_arena.
+        detail::request_arena arena_;
         HTTPParser<Connection> parser_;
         std::unique_ptr<routing_handle_result> routing_handle_result_;
         request& req_;
@@ -602,28 +1023,49 @@ namespace crow
         bool close_connection_ = false;
 
         const std::string& server_name_;
-        std::vector<asio::const_buffer> buffers_;
-
-        std::string content_length_;
-        std::string date_str_;
-        std::string res_body_copy_;
+        /// Head of the response being completed, before it moves into the outbound queue.
+        std::string head_;
+
+        /// Largest piece of a large body or static file sent in one write.
+        static constexpr size_t write_chunk_size = 16384;
+        /// Largest piece of a static file sent in one go with sendfile.
+        static constexpr size_t sendfile_chunk_size = 1 << 20;
+        /// Most small responses sent in one write behind the front one, and their total size.
+        static constexpr size_t max_batched_messages = 32;
+        static constexpr size_t max_batched_bytes = 65536;
+
+        std::deque<detail::outbound_message> outbound_;
+        std::vector<asio::const_buffer> write_buffers_;
+        size_t write_body_bytes_{};
+        size_t write_file_bytes_{};
+        size_t write_batched_{};
+        uint64_t file_range_begin_{};
+        uint64_t file_range_end_{};
+        std::shared_ptr<const std::string> static_body_;
+        size_t unparsed_begin_{};
+        size_t unparsed_end_{};
+        size_t outbound_bytes_{};
+        bool writing_{};
+        bool read_paused_{};
 
         detail::task_timer::identifier_type task_id_{};
 
-        bool continue_requested{};
         bool need_to_call_after_handlers_{};
         bool need_to_start_read_after_complete_{};
         bool add_keep_alive_{};
+        bool in_flight_{};
+        bool counted_{true};
+        bool first_read_{true};
+        bool upgrade_to_http2_{};
 
         std::tuple<Middlewares...>* middlewares_;
         detail::context<Middlewares...> ctx_;
 
-        std::function<std::string()>& get_cached_date_str;
         detail::task_timer& task_timer_;
 
         size_t res_stream_threshold_;
 
-        std::atomic<unsigned int>& queue_length_;
+        detail::io_context_load& load_;
     };
 
 } // namespace crow
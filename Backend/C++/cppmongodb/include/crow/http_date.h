@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <mutex>
+#include <string_view>
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// The current time as an HTTP date, one copy for the whole process.
+
+        ///
+        /// Every \ref Server refreshes it once a second from its main io_context. The text of a new second is written into
+        /// the next of a few slots and then published through an atomic pointer, so reading it is a single atomic load
+        /// and no lock. A slot is only written again `slot_count - 1` seconds after it was replaced, which leaves
+        /// plenty of time to append the view \ref now() returns to a response.
+        class http_date
+        {
+        public:
+            /// The date of the last refresh, e.g. `Sun, 06 Nov 1994 08:49:37 GMT`.
+            static std::string_view now()
+            {
+                const slot* current = instance().current_.load(std::memory_order_acquire);
+                return std::string_view(current->text, current->size);
+            }
+
+            /// Publish the date of this second, unless it already is.
+            static void refresh()
+            {
+                instance().update();
+            }
+
+        private:
+            static constexpr size_t slot_count = 4;
+
+            struct slot
+            {
+                char text[32];
+                size_t size;
+            };
+
+            http_date()
+            {
+                update();
+            }
+
+            static http_date& instance()
+            {
+                static http_date date;
+                return date;
+            }
+
+            void update()
+            {
+                // Several servers may refresh at the same time; only readers go without the lock.
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::time_t time = std::time(nullptr);
+                if (time == last_)
+                    return;
+                last_ = time;
+
+                tm my_tm;
+#if defined(_MSC_VER) || defined(__MINGW32__)
+                gmtime_s(&my_tm, &time);
+#else
+                gmtime_r(&time, &my_tm);
+#endif
+                slot& next = slots_[next_];
+                next_ = (next_ + 1) % slot_count;
+                next.size = strftime(next.text, sizeof(next.text), "%a, %d %b %Y %H:%M:%S GMT", &my_tm);
+                current_.store(&next, std::memory_order_release);
+            }
+
+            std::mutex mutex_;
+            slot slots_[slot_count]{};
+            size_t next_ = 0;
+            std::time_t last_ = -1;
+            std::atomic<const slot*> current_{slots_};
+        };
+    } // namespace detail
+} // namespace crow
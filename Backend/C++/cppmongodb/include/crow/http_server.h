@@ -1,5 +1,7 @@
 #pragma once
 
+#include "crow/settings.h"
+
 #ifdef CROW_USE_BOOST
 #include <boost/asio.hpp>
 #ifdef CROW_ENABLE_SSL
@@ -16,16 +18,29 @@
 #endif
 
 #include <atomic>
+#include <cerrno>
 #include <chrono>
 #include <cstdint>
+#include <cstring>
 #include <future>
 #include <memory>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
+#ifdef CROW_HAS_LOCAL_SOCKETS
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "crow/version.h"
+#include "crow/core_context.h"
+#include "crow/connection_pool.h"
 #include "crow/http_connection.h"
+#include "crow/http_date.h"
+#include "crow/load_balancer.h"
 #include "crow/logging.h"
 #include "crow/task_timer.h"
+#include "crow/thread_affinity.h"
 
 
 namespace crow // NOTE: Already documented in "crow/app.h"
@@ -38,28 +53,72 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 #endif
     using tcp = asio::ip::tcp;
 
+    /// Accepts connections on a TCP port, or on a Unix domain socket when the Adaptor is a \ref UnixSocketAdaptor.
     template<typename Handler, typename Adaptor = SocketAdaptor, typename... Middlewares>
     class Server
     {
     public:
-      Server(Handler* handler,
-             const tcp::endpoint& endpoint,
-             std::string server_name = std::string("Crow/") + VERSION,
-             std::tuple<Middlewares...>* middlewares = nullptr,
-             uint16_t concurrency = 1,
-             uint8_t timeout = 5,
-             typename Adaptor::context* adaptor_ctx = nullptr):
-          acceptor_(io_context_,endpoint),
+        using connection_t = Connection<Adaptor, Handler, Middlewares...>;
+        using protocol = typename Adaptor::protocol;
+        using endpoint_t = typename protocol::endpoint;
+        using acceptor_t = typename protocol::acceptor;
+        static constexpr bool is_tcp = std::is_same<protocol, tcp>::value;
+
+        /// `local_socket_permissions` is the mode given to the socket file when listening on a Unix domain socket.
+        Server(Handler* handler,
+               const endpoint_t& endpoint,
+               std::string server_name = std::string("Crow/") + VERSION,
+               std::tuple<Middlewares...>* middlewares = nullptr,
+               uint16_t concurrency = 1,
+               uint8_t timeout = 5,
+               typename Adaptor::context* adaptor_ctx = nullptr,
+               bool reuse_port = false,
+               unsigned local_socket_permissions = 0660):
+          io_context_load_pool_(concurrency - 1),
+          connection_pools_(concurrency - 1),
+          load_balancer_(io_context_load_pool_, placement_strategy::least_connections),
+          acceptor_(io_context_),
           signals_(io_context_),
           tick_timer_(io_context_),
+          load_sample_timer_(io_context_),
+          date_timer_(io_context_),
           handler_(handler),
           concurrency_(concurrency),
           timeout_(timeout),
           server_name_(server_name),
-          task_queue_length_pool_(concurrency_ - 1),
           middlewares_(middlewares),
-          adaptor_ctx_(adaptor_ctx)
-        {}
+          adaptor_ctx_(adaptor_ctx),
+          reuse_port_(reuse_port),
+          local_socket_permissions_(local_socket_permissions)
+        {
+#ifndef SO_REUSEPORT
+            if (reuse_port_)
+            {
+                CROW_LOG_WARNING << "SO_REUSEPORT is not available on this platform, using a single acceptor";
+                reuse_port_ = false;
+            }
+#endif
+            if (!is_tcp && reuse_port_)
+            {
+                CROW_LOG_WARNING << "SO_REUSEPORT does not apply to Unix domain sockets, using a single acceptor";
+                reuse_port_ = false;
+            }
+            if (reuse_port_)
+                check_port_unused(endpoint);
+            // With SO_REUSEPORT this socket only reserves the port (and resolves port 0); it never listens.
+            // Every io thread binds and listens on its own socket in run().
+            open_acceptor(acceptor_, endpoint);
+            if (!reuse_port_)
+                acceptor_.listen();
+        }
+
+        ~Server()
+        {
+            // Kept connections own sockets of the io_contexts, so they have to go before those are destroyed.
+            for (auto& pool : connection_pools_)
+                pool.clear();
+            remove_socket_file();
+        }
 
         void set_tick_function(std::chrono::milliseconds d, std::function<void()> f)
         {
@@ -67,6 +126,39 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             tick_function_ = f;
         }
 
+        /// How connections accepted by the main acceptor are spread over the io threads.
+        void set_placement_strategy(placement_strategy strategy)
+        {
+            load_balancer_.strategy(strategy);
+        }
+
+        /// Pin every io thread to one CPU, and the thread running the acceptor and tick timer to `housekeeping_cpu`.
+
+        ///
+        /// Io thread i runs on `cpus[i % cpus.size()]`. An empty list means the CPUs this process may use, in NUMA node
+        /// order and without the housekeeping CPU. A negative `housekeeping_cpu` leaves that thread unpinned.
+        void set_thread_affinity(bool pin_io_threads, std::vector<int> cpus, int housekeeping_cpu)
+        {
+            pin_io_threads_ = pin_io_threads;
+            io_thread_cpus_ = std::move(cpus);
+            housekeeping_cpu_ = housekeeping_cpu;
+        }
+
+        /// Shared-nothing mode: every io thread's io_context is told that only that thread runs it.
+
+        ///
+        /// Meant to go with `reuse_port`, so that each io thread also accepts its own connections.
+        void set_per_core(bool per_core)
+        {
+            per_core_ = per_core;
+        }
+
+        /// Run `f` on every io thread before it serves connections, e.g. to put its resources into the \ref core_context.
+        void set_core_start_function(std::function<void(core_context&)> f)
+        {
+            core_start_function_ = std::move(f);
+        }
+
         void on_tick()
         {
             tick_function_();
@@ -81,49 +173,56 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         void run()
         {
             uint16_t worker_thread_count = concurrency_ - 1;
-            for (int i = 0; i < worker_thread_count; i++)
-                io_context_pool_.emplace_back(new asio::io_context());
-            get_cached_date_str_pool_.resize(worker_thread_count);
+            // Every io thread creates its own io_context, after it has been pinned (see below).
+            io_context_pool_.resize(worker_thread_count);
             task_timer_pool_.resize(worker_thread_count);
 
+            if (!pin_io_threads_)
+                io_thread_cpus_.clear();
+            else if (io_thread_cpus_.empty())
+            {
+                for (int cpu : detail::allowed_cpus())
+                    if (cpu != housekeeping_cpu_)
+                        io_thread_cpus_.push_back(cpu);
+                if (io_thread_cpus_.empty())
+                    CROW_LOG_WARNING << "No CPUs left to pin the io threads to";
+            }
+
             std::vector<std::future<void>> v;
             std::atomic<int> init_count(0);
             for (uint16_t i = 0; i < worker_thread_count; i++)
                 v.push_back(
                   std::async(
                     std::launch::async, [this, i, &init_count] {
-                        // thread local date string get function
-                        auto last = std::chrono::steady_clock::now();
-
-                        std::string date_str;
-                        auto update_date_str = [&] {
-                            auto last_time_t = time(0);
-                            tm my_tm;
-
-#if defined(_MSC_VER) || defined(__MINGW32__)
-                            gmtime_s(&my_tm, &last_time_t);
-#else
-                            gmtime_r(&last_time_t, &my_tm);
-#endif
-                            date_str.resize(100);
-                            size_t date_str_sz = strftime(&date_str[0], 99, "%a, %d %b %Y %H:%M:%S GMT", &my_tm);
-                            date_str.resize(date_str_sz);
-                        };
-                        update_date_str();
-                        get_cached_date_str_pool_[i] = [&]() -> std::string {
-                            if (std::chrono::steady_clock::now() - last >= std::chrono::seconds(1))
-                            {
-                                last = std::chrono::steady_clock::now();
-                                update_date_str();
-                            }
-                            return date_str;
-                        };
+                        // Pinning first means the memory this thread touches from here on (its io_context, its timers
+                        // and, with reuse_port, the connections it accepts) is allocated on its own NUMA node.
+                        if (!io_thread_cpus_.empty())
+                        {
+                            int cpu = io_thread_cpus_[i % io_thread_cpus_.size()];
+                            if (!detail::pin_current_thread(cpu))
+                                CROW_LOG_WARNING << "Can not pin io thread " << i << " to CPU " << cpu;
+                        }
+                        // A concurrency hint of 1 lets Asio skip waking other threads and use cheaper locking in its scheduler.
+                        io_context_pool_[i].reset(per_core_ ? new asio::io_context(1) : new asio::io_context());
 
                         // initializing task timers
                         detail::task_timer task_timer(*io_context_pool_[i]);
                         task_timer.set_default_timeout(timeout_);
                         task_timer_pool_[i] = &task_timer;
-                        task_queue_length_pool_[i] = 0;
+
+                        core_context core(i, *io_context_pool_[i], task_timer);
+                        detail::current_core = &core;
+                        if (core_start_function_)
+                        {
+                            try
+                            {
+                                core_start_function_(core);
+                            }
+                            catch (std::exception& e)
+                            {
+                                CROW_LOG_ERROR << "Setting up io thread " << i << " failed: " << e.what();
+                            }
+                        }
 
                         init_count++;
                         while (1)
@@ -141,6 +240,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                                 CROW_LOG_ERROR << "Worker Crash: An uncaught exception occurred: " << e.what();
                             }
                         }
+                        detail::current_core = nullptr;
                     }));
 
             if (tick_function_ && tick_interval_.count() > 0)
@@ -154,13 +254,24 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                   });
             }
 
-            handler_->port(acceptor_.local_endpoint().port());
+            if (!reuse_port_ && load_balancer_.strategy() == placement_strategy::busy_time)
+                sample_load();
+            refresh_date();
+
+            handler_->port(port());
 
 
             CROW_LOG_INFO << server_name_
-                          << " server is running at " << (handler_->ssl_used() ? "https://" : "http://")
-                          << acceptor_.local_endpoint().address() << ":" << acceptor_.local_endpoint().port() << " using " << concurrency_ << " threads";
+                          << " server is running at " << listen_address() << " using " << concurrency_ << " threads"
+                          << (reuse_port_ ? " (one SO_REUSEPORT listener per io thread)" : "");
             CROW_LOG_INFO << "Call `app.loglevel(crow::LogLevel::Warning)` to hide Info level logs.";
+#ifdef CROW_USE_IO_URING
+#if defined(BOOST_ASIO_HAS_IO_URING_AS_DEFAULT) || defined(ASIO_HAS_IO_URING_AS_DEFAULT)
+            CROW_LOG_INFO << "IO threads use io_uring";
+#else
+            CROW_LOG_WARNING << "CROW_USE_IO_URING is set but this Asio has no io_uring backend, falling back to epoll";
+#endif
+#endif
 
             signals_.async_wait(
               [&](const error_code& /*error*/, int /*signal_number*/) {
@@ -170,10 +281,25 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             while (worker_thread_count != init_count)
                 std::this_thread::yield();
 
-            do_accept();
+            if (reuse_port_)
+            {
+                for (uint16_t i = 0; i < worker_thread_count; i++)
+                {
+                    worker_acceptors_.emplace_back(new acceptor_t(*io_context_pool_[i]));
+                    open_acceptor(*worker_acceptors_[i], acceptor_.local_endpoint());
+                    worker_acceptors_[i]->listen();
+                    asio::post(*io_context_pool_[i], [this, i] {
+                        do_accept(i);
+                    });
+                }
+            }
+            else
+                do_accept();
 
             std::thread(
               [this] {
+                  if (housekeeping_cpu_ >= 0 && !detail::pin_current_thread(housekeeping_cpu_))
+                      CROW_LOG_WARNING << "Can not pin the acceptor thread to CPU " << housekeeping_cpu_;
                   notify_start();
                   io_context_.run();
                   CROW_LOG_INFO << "Exiting.";
@@ -197,8 +323,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             io_context_.stop(); // Close main io_service
         }
 
-        uint16_t port() const {
-            return acceptor_.local_endpoint().port();
+        /// The TCP port the server listens on, 0 for a Unix domain socket.
+        uint16_t port() const
+        {
+            if constexpr (is_tcp)
+                return acceptor_.local_endpoint().port();
+            else
+                return 0;
         }
 
         /// Wait until the server has properly started or until timeout
@@ -223,34 +354,44 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         }
 
     private:
-        uint16_t pick_io_context_idx()
+        /// Feed the busy time of every io thread into the load balancer's averages, and again every 100ms.
+        void sample_load()
         {
-            uint16_t min_queue_idx = 0;
+            load_balancer_.sample();
+            load_sample_timer_.expires_after(std::chrono::milliseconds(100));
+            load_sample_timer_.async_wait([this](const error_code& ec) {
+                if (ec)
+                    return;
+                sample_load();
+            });
+        }
 
-            // TODO improve load balancing
-            // size_t is used here to avoid the security issue https://codeql.github.com/codeql-query-help/cpp/cpp-comparison-with-wider-type/
-            // even though the max value of this can be only uint16_t as concurrency is uint16_t.
-            for (size_t i = 1; i < task_queue_length_pool_.size() && task_queue_length_pool_[min_queue_idx] > 0; i++)
-            // No need to check other io_services if the current one has no tasks
-            {
-                if (task_queue_length_pool_[i] < task_queue_length_pool_[min_queue_idx])
-                    min_queue_idx = i;
-            }
-            return min_queue_idx;
+        /// Bring the Date header of all responses up to date, and again just after every new second.
+        void refresh_date()
+        {
+            detail::http_date::refresh();
+            auto into_second = std::chrono::system_clock::now().time_since_epoch() % std::chrono::seconds(1);
+            date_timer_.expires_after(std::chrono::seconds(1) - into_second);
+            date_timer_.async_wait([this](const error_code& ec) {
+                if (ec)
+                    return;
+                refresh_date();
+            });
         }
 
         void do_accept()
         {
             if (!shutting_down_)
             {
-                uint16_t context_idx = pick_io_context_idx();
+                uint16_t context_idx = load_balancer_.pick();
                 asio::io_context& ic = *io_context_pool_[context_idx];
-                task_queue_length_pool_[context_idx]++;
-                CROW_LOG_DEBUG << &ic << " {" << context_idx << "} queue length: " << task_queue_length_pool_[context_idx];
+                // The connection gives this back when it is destroyed or recycled, including when the accept fails.
+                io_context_load_pool_[context_idx].connections++;
+                CROW_LOG_DEBUG << &ic << " {" << context_idx << "} connections: " << io_context_load_pool_[context_idx].connections;
 
-                auto p = std::make_shared<Connection<Adaptor, Handler, Middlewares...>>(
+                auto p = connection_pools_[context_idx].acquire(
                   ic, handler_, server_name_, middlewares_,
-                  get_cached_date_str_pool_[context_idx], *task_timer_pool_[context_idx], adaptor_ctx_, task_queue_length_pool_[context_idx]);
+                  *task_timer_pool_[context_idx], adaptor_ctx_, io_context_load_pool_[context_idx]);
 
                 acceptor_.async_accept(
                   p->socket(),
@@ -264,14 +405,126 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                       }
                       else
                       {
-                          task_queue_length_pool_[context_idx]--;
-                          CROW_LOG_DEBUG << &ic << " {" << context_idx << "} queue length: " << task_queue_length_pool_[context_idx];
+                          CROW_LOG_DEBUG << &ic << " {" << context_idx << "} accept failed: " << ec.message();
                       }
                       do_accept();
                   });
             }
         }
 
+        /// Accept loop of a single io thread in SO_REUSEPORT mode.
+
+        ///
+        /// The kernel spreads incoming connections over the per-thread listening sockets, so each connection is
+        /// accepted and served by the same thread with no handoff through the main io_context.
+        void do_accept(uint16_t context_idx)
+        {
+            if (!shutting_down_)
+            {
+                asio::io_context& ic = *io_context_pool_[context_idx];
+                io_context_load_pool_[context_idx].connections++;
+
+                auto p = connection_pools_[context_idx].acquire(
+                  ic, handler_, server_name_, middlewares_,
+                  *task_timer_pool_[context_idx], adaptor_ctx_, io_context_load_pool_[context_idx]);
+
+                worker_acceptors_[context_idx]->async_accept(
+                  p->socket(),
+                  [this, p, context_idx](error_code ec) {
+                      if (!ec)
+                          p->start();
+                      do_accept(context_idx);
+                  });
+            }
+        }
+
+        /// Throw, like a plain bind would, if another server already listens on the port.
+
+        ///
+        /// A second server that sets SO_REUSEPORT as well can bind the same port without an error and then gets part
+        /// of the connections. A short bind without the option still fails in that case, so it is tried first.
+        void check_port_unused(const endpoint_t& endpoint)
+        {
+            if constexpr (is_tcp)
+            {
+                if (endpoint.port() == 0)
+                    return;
+                acceptor_t probe(io_context_);
+                probe.open(endpoint.protocol());
+                probe.set_option(tcp::acceptor::reuse_address(true));
+                probe.bind(endpoint);
+            }
+        }
+
+        void open_acceptor(acceptor_t& acceptor, const endpoint_t& endpoint)
+        {
+            if constexpr (is_tcp)
+            {
+                acceptor.open(endpoint.protocol());
+                acceptor.set_option(tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+                if (reuse_port_)
+                    acceptor.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#endif
+                acceptor.bind(endpoint);
+            }
+#ifdef CROW_HAS_LOCAL_SOCKETS
+            else
+            {
+                remove_stale_socket(endpoint.path());
+                acceptor.open(endpoint.protocol());
+                acceptor.bind(endpoint);
+                socket_path_ = endpoint.path();
+                // Nobody can connect before listen(), so the socket is never reachable with the umask's permissions.
+                if (::chmod(socket_path_.c_str(), static_cast<mode_t>(local_socket_permissions_)) != 0)
+                    CROW_LOG_WARNING << "Can not set the permissions of " << socket_path_ << ": " << strerror(errno);
+            }
+#endif
+        }
+
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        /// Delete a socket file left behind by a server that is no longer running.
+
+        ///
+        /// A socket that still accepts connections belongs to a running server and is left alone, as is anything that
+        /// is not a socket (binding then fails). Abstract socket names (starting with a NUL) have no file.
+        static void remove_stale_socket(const std::string& path)
+        {
+            struct stat st;
+            if (path.empty() || path[0] == '\0' || ::lstat(path.c_str(), &st) != 0 || !S_ISSOCK(st.st_mode))
+                return;
+
+            asio::io_context ic;
+            typename protocol::socket probe(ic);
+            error_code ec;
+            probe.connect(endpoint_t(path), ec);
+            if (!ec)
+                throw std::runtime_error("Another server is already listening on " + path);
+            if (ec != asio::error::connection_refused)
+                return;
+
+            CROW_LOG_INFO << "Removing stale socket " << path;
+            ::unlink(path.c_str());
+        }
+#endif
+
+        /// Delete the socket file this server created, if it listens on a Unix domain socket.
+        void remove_socket_file()
+        {
+#ifdef CROW_HAS_LOCAL_SOCKETS
+            if (!socket_path_.empty())
+                ::unlink(socket_path_.c_str());
+#endif
+        }
+
+        std::string listen_address() const
+        {
+            if constexpr (is_tcp)
+                return (handler_->ssl_used() ? "https://" : "http://") + acceptor_.local_endpoint().address().to_string() + ":" + std::to_string(acceptor_.local_endpoint().port());
+            else
+                return "unix:" + socket_path_;
+        }
+
         /// Notify anything using `wait_for_start()` to proceed
         void notify_start()
         {
@@ -281,24 +534,29 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         }
 
     private:
+        // Connections still queued on the io_contexts release their load when those are destroyed, so these go first.
+        std::vector<detail::io_context_load> io_context_load_pool_;
+        std::vector<detail::connection_pool<connection_t>> connection_pools_; ///< One per io thread, like the load.
+        detail::load_balancer load_balancer_;
         std::vector<std::unique_ptr<asio::io_context>> io_context_pool_;
+        std::vector<std::unique_ptr<acceptor_t>> worker_acceptors_;
         asio::io_context io_context_;
         std::vector<detail::task_timer*> task_timer_pool_;
-        std::vector<std::function<std::string()>> get_cached_date_str_pool_;
-        tcp::acceptor acceptor_;
-        bool shutting_down_ = false;
+        acceptor_t acceptor_;
+        std::atomic<bool> shutting_down_{false};
         bool server_started_{false};
         std::condition_variable cv_started_;
         std::mutex start_mutex_;
         asio::signal_set signals_;
 
         asio::basic_waitable_timer<std::chrono::high_resolution_clock> tick_timer_;
+        asio::steady_timer load_sample_timer_;
+        asio::steady_timer date_timer_;
 
         Handler* handler_;
         uint16_t concurrency_{2};
         std::uint8_t timeout_;
         std::string server_name_;
-        std::vector<std::atomic<unsigned int>> task_queue_length_pool_;
 
         std::chrono::milliseconds tick_interval_;
         std::function<void()> tick_function_;
@@ -306,5 +564,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
         std::tuple<Middlewares...>* middlewares_;
 
         typename Adaptor::context* adaptor_ctx_;
+        bool reuse_port_;
+        bool per_core_{false};
+        std::function<void(core_context&)> core_start_function_;
+        bool pin_io_threads_{false};
+        std::vector<int> io_thread_cpus_;
+        int housekeeping_cpu_{-1};
+        unsigned local_socket_permissions_;
+        std::string socket_path_; ///< The socket file of a Unix domain socket server, removed again on destruction.
     };
 } // namespace crow
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <new>
+
+#include "crow/connection_pool.h"
+#include "crow/settings.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// Memory for what a connection builds while parsing one request, handed out by bumping a pointer.
+
+        ///
+        /// Nothing is freed one by one: \ref release() forgets everything at once when the request is done and keeps the
+        /// first block for the next request on the connection. That block is a read buffer borrowed from the io thread's
+        /// \ref read_buffer_pool, which \ref trim() returns while the connection waits for its next request. Blocks
+        /// added when the first one is full come from the heap, so the arena may be released from any thread.
+        class request_arena : public std::pmr::memory_resource
+        {
+        public:
+            request_arena() = default;
+            request_arena(const request_arena&) = delete;
+            request_arena& operator=(const request_arena&) = delete;
+
+            ~request_arena()
+            {
+                release();
+            }
+
+            /// Forget everything allocated so far, keeping the first block.
+            void release()
+            {
+                while (extra_)
+                {
+                    block* next = extra_->next;
+                    ::operator delete(extra_);
+                    extra_ = next;
+                }
+                used_ = 0;
+            }
+
+            /// Return the first block to the calling thread's read buffer pool, unless something still lives in it.
+            void trim()
+            {
+                if (first_ && used_ == 0 && !extra_)
+                    read_buffer_pool::local().release(std::move(first_));
+            }
+
+            /// Forget everything and free all blocks, from a thread that may not be the connection's io thread.
+            void reset()
+            {
+                release();
+                first_.reset();
+            }
+
+        private:
+            struct block
+            {
+                block* next;
+                std::size_t size;
+                std::size_t used;
+            };
+
+            static constexpr std::size_t header_size = (sizeof(block) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+            static char* data(block* b)
+            {
+                return reinterpret_cast<char*>(b) + header_size;
+            }
+
+            static void* bump(char* begin, std::size_t size, std::size_t& used, std::size_t bytes, std::size_t alignment)
+            {
+                std::uintptr_t base = reinterpret_cast<std::uintptr_t>(begin);
+                std::uintptr_t at = (base + used + alignment - 1) & ~(static_cast<std::uintptr_t>(alignment) - 1);
+                if (at + bytes > base + size)
+                    return nullptr;
+                used = at + bytes - base;
+                return reinterpret_cast<void*>(at);
+            }
+
+            void* do_allocate(std::size_t bytes, std::size_t alignment) override
+            {
+                if (alignment > alignof(std::max_align_t))
+                    throw std::bad_alloc();
+
+                if (!first_)
+                    first_ = read_buffer_pool::local().acquire();
+                if (!extra_)
+                {
+                    if (void* p = bump(first_->data(), first_->size(), used_, bytes, alignment))
+                        return p;
+                }
+                else if (void* p = bump(data(extra_), extra_->size, extra_->used, bytes, alignment))
+                    return p;
+
+                // Out of room, continue in a new block.
+                std::size_t size = std::max<std::size_t>(bytes, CROW_REQUEST_ARENA_BLOCK_SIZE);
+                block* b = static_cast<block*>(::operator new(header_size + size));
+                b->next = extra_;
+                b->size = size;
+                b->used = 0;
+                extra_ = b;
+                return bump(data(b), size, b->used, bytes, alignment);
+            }
+
+            void do_deallocate(void*, std::size_t, std::size_t) override
+            {}
+
+            bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+            {
+                return this == &other;
+            }
+
+            std::unique_ptr<read_buffer_pool::buffer> first_;
+            std::size_t used_ = 0;
+            /// Blocks added once the first one was full, the newest first.
+            block* extra_ = nullptr;
+        };
+    } // namespace detail
+} // namespace crow
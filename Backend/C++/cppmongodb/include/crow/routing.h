@@ -18,6 +18,7 @@
 #include "crow/websocket.h"
 #include "crow/mustache.h"
 #include "crow/middleware.h"
+#include "crow/task.h"
 
 namespace crow // NOTE: Already documented in "crow/app.h"
 {
@@ -128,6 +129,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             res.end();
         }
 #endif
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        virtual void handle_upgrade(const request&, response& res, UnixSocketAdaptor&&)
+        {
+            res = response(404);
+            res.end();
+        }
+#endif
 
         uint32_t get_methods()
         {
@@ -249,8 +257,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                 void set_(Func f, typename std::enable_if<!std::is_same<typename std::tuple_element<0, std::tuple<Args..., void>>::type, const request&>::value, int>::type = 0)
                 {
                     handler_ = ([f = std::move(f)](const request&, response& res, Args... args) {
-                        res = response(f(args...));
-                        res.end();
+                        detail::handler_result(res, f(args...));
                     });
                 }
 
@@ -264,8 +271,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
 
                     void operator()(const request& req, response& res, Args... args)
                     {
-                        res = response(f(req, args...));
-                        res.end();
+                        detail::handler_result(res, f(req, args...));
                     }
 
                     Func f;
@@ -349,8 +355,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                           "Handler function cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
 
             handler_ = ([f = std::move(f)](const request&, response& res) {
-                res = response(f());
-                res.end();
+                detail::handler_result(res, f());
             });
         }
 
@@ -365,8 +370,7 @@ namespace crow // NOTE: Already documented in "crow/app.h"
                           "Handler function cannot have void return type; valid return types: string, int, crow::response, crow::returnable");
 
             handler_ = ([f = std::move(f)](const request& req, response& res) {
-                res = response(f(req));
-                res.end();
+                detail::handler_result(res, f(req));
             });
         }
 
@@ -448,6 +452,13 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             new crow::websocket::Connection<SSLAdaptor, App>(req, std::move(adaptor), app_, max_payload_, subprotocols_, open_handler_, message_handler_, close_handler_, error_handler_, accept_handler_, mirror_protocols_);
         }
 #endif
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        void handle_upgrade(const request& req, response&, UnixSocketAdaptor&& adaptor) override
+        {
+            max_payload_ = max_payload_override_ ? max_payload_ : app_->websocket_max_payload();
+            new crow::websocket::Connection<UnixSocketAdaptor, App>(req, std::move(adaptor), app_, max_payload_, subprotocols_, open_handler_, message_handler_, close_handler_, error_handler_, accept_handler_, mirror_protocols_);
+        }
+#endif
 
         /// Override the global payload limit for this single WebSocket rule
         self_t& max_payload(uint64_t max_payload)
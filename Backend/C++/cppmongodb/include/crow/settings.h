@@ -31,6 +31,78 @@
 #ifndef CROW_STATIC_ENDPOINT
 #define CROW_STATIC_ENDPOINT "/static/<path>"
 #endif
+/* #define - number of open static files kept for reuse */
+#ifndef CROW_STATIC_FILE_CACHE_SIZE
+#define CROW_STATIC_FILE_CACHE_SIZE 256
+#endif
+/* #define - bytes of small static files (and their compressed variants) kept in memory, and the size up to which a file counts as small */
+#ifndef CROW_STATIC_ASSET_CACHE_SIZE
+#define CROW_STATIC_ASSET_CACHE_SIZE (32 * 1024 * 1024)
+#endif
+#ifndef CROW_STATIC_ASSET_MAX_SIZE
+#define CROW_STATIC_ASSET_MAX_SIZE (256 * 1024)
+#endif
+
+/* #define - closed connections each io thread keeps for reuse instead of allocating new ones */
+#ifndef CROW_CONNECTION_POOL_SIZE
+#define CROW_CONNECTION_POOL_SIZE 128
+#endif
+
+/* #define - idle read buffers (4 KiB each) each io thread keeps for the connections that have data to parse */
+#ifndef CROW_READ_BUFFER_POOL_SIZE
+#define CROW_READ_BUFFER_POOL_SIZE 256
+#endif
+
+/* #define - size of the blocks added to a connection's request arena once its first block (a read buffer) is full */
+#ifndef CROW_REQUEST_ARENA_BLOCK_SIZE
+#define CROW_REQUEST_ARENA_BLOCK_SIZE 4096
+#endif
+
+/* #define - bytes of responses queued for one client before Crow stops reading its requests,
+   and the level the queue has to drain to before reading resumes */
+#ifndef CROW_OUTBOUND_HIGH_WATERMARK
+#define CROW_OUTBOUND_HIGH_WATERMARK (1024 * 1024)
+#endif
+#ifndef CROW_OUTBOUND_LOW_WATERMARK
+#define CROW_OUTBOUND_LOW_WATERMARK (256 * 1024)
+#endif
+
+/* #define - streams a client may have open at once on an HTTP/2 connection */
+#ifndef CROW_HTTP2_MAX_CONCURRENT_STREAMS
+#define CROW_HTTP2_MAX_CONCURRENT_STREAMS 100
+#endif
+
+/* #ifdef - parses the request line and headers of plain requests (complete in one read, Content-Length or no body)
+   in one pass, with AVX2 or SSE4.2 when compiled for them (e.g. -mavx2). Other requests still go through http_parser */
+//#define CROW_USE_SIMD_PARSER
+
+/* #ifdef - runs the io threads on Linux io_uring instead of epoll (needs liburing, link with -luring,
+   and Boost 1.78+ or standalone Asio 1.21+). Asio then batches the reads, writes and accepts of
+   each io thread into shared submissions */
+//#define CROW_USE_IO_URING
+#ifdef CROW_USE_IO_URING
+#ifdef CROW_USE_BOOST
+#include <boost/version.hpp>
+#if BOOST_VERSION >= 107800 // older versions would fall back to select() once epoll is disabled
+#ifndef BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_HAS_IO_URING
+#endif
+#ifndef BOOST_ASIO_DISABLE_EPOLL
+#define BOOST_ASIO_DISABLE_EPOLL
+#endif
+#endif
+#else
+#include <asio/version.hpp>
+#if ASIO_VERSION >= 102100
+#ifndef ASIO_HAS_IO_URING
+#define ASIO_HAS_IO_URING
+#endif
+#ifndef ASIO_DISABLE_EPOLL
+#define ASIO_DISABLE_EPOLL
+#endif
+#endif
+#endif
+#endif
 
 // compiler flags
 
@@ -41,3 +113,9 @@
 #define noexcept throw()
 #endif
 #endif
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define CROW_CAN_USE_COROUTINES
+#endif
+#endif
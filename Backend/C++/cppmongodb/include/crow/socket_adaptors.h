@@ -1,5 +1,7 @@
 #pragma once
 
+#include "crow/settings.h"
+
 #ifdef CROW_USE_BOOST
 #include <boost/asio.hpp>
 #include <boost/asio/version.hpp>
@@ -16,7 +18,6 @@
 #include <asio/ssl.hpp>
 #endif
 #endif
-#include "crow/settings.h"
 
 #if (CROW_USE_BOOST && BOOST_VERSION >= 107000) || (ASIO_VERSION >= 101300)
 #define GET_IO_CONTEXT(s) ((asio::io_context&)(s).get_executor().context())
@@ -24,6 +25,10 @@
 #define GET_IO_CONTEXT(s) ((s).get_executor().context())
 #endif
 
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS) || defined(ASIO_HAS_LOCAL_SOCKETS)
+#define CROW_HAS_LOCAL_SOCKETS
+#endif
+
 namespace crow
 {
 #ifdef CROW_USE_BOOST
@@ -38,6 +43,9 @@ namespace crow
     struct SocketAdaptor
     {
         using context = void;
+        using protocol = tcp;
+        /// Whether file data can be handed to the socket by the kernel (sendfile), i.e. nothing is layered on top.
+        static constexpr bool can_sendfile = true;
         SocketAdaptor(asio::io_context& io_context, context*):
           socket_(io_context)
         {}
@@ -64,6 +72,12 @@ namespace crow
             return socket_.remote_endpoint();
         }
 
+        /// The IP address of the client.
+        std::string address()
+        {
+            return socket_.remote_endpoint().address().to_string();
+        }
+
         bool is_open()
         {
             return socket_.is_open();
@@ -102,11 +116,90 @@ namespace crow
         tcp::socket socket_;
     };
 
+#ifdef CROW_HAS_LOCAL_SOCKETS
+    /// A wrapper for the asio::local::stream_protocol::socket, for clients connecting through a Unix domain socket.
+    struct UnixSocketAdaptor
+    {
+        using context = void;
+        using protocol = asio::local::stream_protocol;
+        static constexpr bool can_sendfile = true;
+        UnixSocketAdaptor(asio::io_context& io_context, context*):
+          socket_(io_context)
+        {}
+
+        asio::io_context& get_io_context()
+        {
+            return GET_IO_CONTEXT(socket_);
+        }
+
+        protocol::socket& raw_socket()
+        {
+            return socket_;
+        }
+
+        protocol::socket& socket()
+        {
+            return socket_;
+        }
+
+        protocol::endpoint remote_endpoint()
+        {
+            return socket_.remote_endpoint();
+        }
+
+        /// Peers of a Unix domain socket have no address, so this is the path the server listens on.
+        std::string address()
+        {
+            error_code ec;
+            return "unix:" + socket_.local_endpoint(ec).path();
+        }
+
+        bool is_open()
+        {
+            return socket_.is_open();
+        }
+
+        void close()
+        {
+            error_code ec;
+            socket_.close(ec);
+        }
+
+        void shutdown_readwrite()
+        {
+            error_code ec;
+            socket_.shutdown(asio::socket_base::shutdown_type::shutdown_both, ec);
+        }
+
+        void shutdown_write()
+        {
+            error_code ec;
+            socket_.shutdown(asio::socket_base::shutdown_type::shutdown_send, ec);
+        }
+
+        void shutdown_read()
+        {
+            error_code ec;
+            socket_.shutdown(asio::socket_base::shutdown_type::shutdown_receive, ec);
+        }
+
+        template<typename F>
+        void start(F f)
+        {
+            f(error_code());
+        }
+
+        protocol::socket socket_;
+    };
+#endif
+
 #ifdef CROW_ENABLE_SSL
     struct SSLAdaptor
     {
         using context = asio::ssl::context;
+        using protocol = tcp;
         using ssl_socket_t = asio::ssl::stream<tcp::socket>;
+        static constexpr bool can_sendfile = false;
         SSLAdaptor(asio::io_context& io_context, context* ctx):
           ssl_socket_(new ssl_socket_t(io_context, *ctx))
         {}
@@ -127,6 +220,12 @@ namespace crow
             return raw_socket().remote_endpoint();
         }
 
+        /// The IP address of the client.
+        std::string address()
+        {
+            return raw_socket().remote_endpoint().address().to_string();
+        }
+
         bool is_open()
         {
             return ssl_socket_ ? raw_socket().is_open() : false;
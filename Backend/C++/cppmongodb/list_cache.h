@@ -0,0 +1,293 @@
+#pragma once
+
+#include <mongocxx/client.hpp>
+#include <mongocxx/uri.hpp>
+#include <mongocxx/pipeline.hpp>
+#include <mongocxx/options/change_stream.hpp>
+#include <mongocxx/exception/operation_exception.hpp>
+#include <bsoncxx/document/value.hpp>
+#include <bsoncxx/types.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/crow.h"
+
+// In-process copy of the "lists" collection kept coherent by a change stream.
+//
+// A background thread opens collection.watch(), loads the collection once and
+// then applies every insert/update/replace/delete event to an id -> list map.
+// GET /lists is answered from a pre-serialized JSON snapshot that is rebuilt
+// lazily after a change. The resume token of the last applied event is kept so
+// that a dropped stream picks up where it left off; if the server can no longer
+// resume from it the collection is reloaded from scratch.
+//
+// The stream is the only thing that changes the cache, so every instance of the
+// service applies the writes of all instances in the same order. A writer that
+// wants to read its own write from the cache waits for the stream to get there
+// with wait_for().
+//
+// Reads must only be served from the cache while ready() is true. Until the
+// stream has caught up after the first load or a reconnect, and whenever it is
+// down, the cache may be stale and callers fall back to the server. Change
+// streams need a replica set; on a standalone mongod the watcher never becomes
+// ready and every read goes to the server as before.
+class ListCache
+{
+public:
+    explicit ListCache(std::string uri, std::string db = "listdb", std::string coll = "lists"):
+      uri_(std::move(uri)), db_(std::move(db)), coll_(std::move(coll))
+    {}
+
+    ~ListCache()
+    {
+        stop();
+    }
+
+    void start()
+    {
+        running_ = true;
+        watcher_ = std::thread([this] {
+            watch_loop();
+        });
+    }
+
+    void stop()
+    {
+        running_ = false;
+        if (watcher_.joinable())
+            watcher_.join();
+    }
+
+    bool ready() const
+    {
+        return ready_;
+    }
+
+    /// Look up a single item. Only meaningful while ready() is true.
+    std::optional<std::string> get(const std::string& id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        auto it = items_.find(id);
+        if (it == items_.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    /// JSON array of every item, in _id order (insertion order for ObjectIds).
+    std::shared_ptr<const std::string> snapshot() const
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            if (snapshot_)
+                return snapshot_;
+        }
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        if (!snapshot_)
+        {
+            std::vector<crow::json::wvalue> items;
+            items.reserve(items_.size());
+            for (const auto& kv : items_)
+            {
+                crow::json::wvalue item;
+                item["_id"] = kv.first;
+                item["list"] = kv.second;
+                items.push_back(std::move(item));
+            }
+            snapshot_ = std::make_shared<const std::string>(crow::json::wvalue(std::move(items)).dump());
+        }
+        return snapshot_;
+    }
+
+    /// Block until the stream has applied every change up to `operation_time`,
+    /// the operationTime of a write, so that reads from the cache see it.
+    /// Returns false if that takes longer than `timeout`. Returns at once while
+    /// the cache is not ready, as reads go to the server then.
+    bool wait_for(bsoncxx::types::b_timestamp operation_time,
+                  std::chrono::milliseconds timeout = std::chrono::seconds(2)) const
+    {
+        std::unique_lock<std::mutex> lock(applied_mutex_);
+        return applied_cv_.wait_for(lock, timeout, [&] {
+            return !ready_ || !before(applied_, operation_time);
+        });
+    }
+
+private:
+    static bool before(bsoncxx::types::b_timestamp l, bsoncxx::types::b_timestamp r)
+    {
+        return l.timestamp < r.timestamp || (l.timestamp == r.timestamp && l.increment < r.increment);
+    }
+
+    void put(const std::string& id, const std::string& list)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        items_[id] = list;
+        snapshot_.reset();
+    }
+
+    void erase(const std::string& id)
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        items_.erase(id);
+        snapshot_.reset();
+    }
+
+    void set_ready(bool ready)
+    {
+        {
+            std::lock_guard<std::mutex> lock(applied_mutex_);
+            ready_ = ready;
+        }
+        applied_cv_.notify_all();
+    }
+
+    static std::string list_of(const bsoncxx::document::view& doc)
+    {
+        if (doc["list"] && doc["list"].type() == bsoncxx::type::k_utf8)
+            return std::string(doc["list"].get_utf8().value.to_string());
+        return "";
+    }
+
+    void reload(mongocxx::collection& collection)
+    {
+        std::map<std::string, std::string> fresh;
+        for (auto&& doc : collection.find({}))
+            fresh[doc["_id"].get_oid().value.to_string()] = list_of(doc);
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+        items_.swap(fresh);
+        snapshot_.reset();
+    }
+
+    /// Returns false if the stream can't go on (the collection is gone).
+    bool apply(const bsoncxx::document::view& event)
+    {
+        std::string op(event["operationType"].get_utf8().value.to_string());
+        if (op == "insert" || op == "update" || op == "replace")
+        {
+            auto id = event["documentKey"]["_id"].get_oid().value.to_string();
+            // updateLookup returns the current document, or nothing if it has
+            // been deleted since; the delete event will follow in that case.
+            if (event["fullDocument"] && event["fullDocument"].type() == bsoncxx::type::k_document)
+                put(id, list_of(event["fullDocument"].get_document().value));
+        }
+        else if (op == "delete")
+        {
+            erase(event["documentKey"]["_id"].get_oid().value.to_string());
+        }
+        else if (op == "drop" || op == "dropDatabase" || op == "rename" || op == "invalidate")
+        {
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex_);
+                items_.clear();
+                snapshot_.reset();
+            }
+            resume_token_.reset();
+            set_ready(false);
+            return false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(applied_mutex_);
+            applied_ = event["clusterTime"].get_timestamp();
+        }
+        applied_cv_.notify_all();
+        return true;
+    }
+
+    void watch_loop()
+    {
+        auto backoff = std::chrono::milliseconds(100);
+        while (running_)
+        {
+            try
+            {
+                // The watcher has its own client: mongocxx clients must not be
+                // shared across threads.
+                mongocxx::client client{mongocxx::uri{uri_}};
+                auto collection = client[db_][coll_];
+
+                mongocxx::options::change_stream opts;
+                opts.full_document(bsoncxx::string::view_or_value{"updateLookup"});
+                opts.max_await_time(std::chrono::milliseconds(500));
+                if (resume_token_)
+                    opts.resume_after(resume_token_->view());
+
+                // Open the stream before loading so no change between the load
+                // and the first event is lost; replaying one is harmless.
+                auto stream = collection.watch(mongocxx::pipeline{}, opts);
+                if (!resume_token_)
+                    reload(collection);
+
+                bool live = true;
+                while (running_ && live)
+                {
+                    for (auto&& event : stream)
+                    {
+                        live = apply(event);
+                        if (!live)
+                            break;
+                    }
+                    if (!live)
+                        break;
+                    if (auto token = stream.get_resume_token())
+                        resume_token_ = bsoncxx::document::value(*token);
+                    // A pass ends when the server has nothing more: the changes
+                    // made during the load, or while the stream was down, are in.
+                    if (!ready_)
+                    {
+                        set_ready(true);
+                        backoff = std::chrono::milliseconds(100);
+                    }
+                }
+            }
+            catch (const mongocxx::operation_exception& e)
+            {
+                // ChangeStreamHistoryLost (286): the token fell off the oplog.
+                if (e.code().value() == 286)
+                    resume_token_.reset();
+                set_ready(false);
+                CROW_LOG_WARNING << "List cache stream error: " << e.what();
+            }
+            catch (const std::exception& e)
+            {
+                set_ready(false);
+                CROW_LOG_WARNING << "List cache stream error: " << e.what();
+            }
+
+            if (running_ && !ready_)
+            {
+                std::this_thread::sleep_for(backoff);
+                backoff = std::min(backoff * 2, std::chrono::milliseconds(5000));
+            }
+        }
+        set_ready(false);
+    }
+
+    std::string uri_;
+    std::string db_;
+    std::string coll_;
+
+    std::atomic<bool> running_{false};
+    std::atomic<bool> ready_{false};
+    std::thread watcher_;
+    std::optional<bsoncxx::document::value> resume_token_;
+
+    // clusterTime of the last applied event, for wait_for().
+    mutable std::mutex applied_mutex_;
+    mutable std::condition_variable applied_cv_;
+    bsoncxx::types::b_timestamp applied_{};
+
+    mutable std::shared_mutex mutex_;
+    std::map<std::string, std::string> items_;
+    mutable std::shared_ptr<const std::string> snapshot_;
+};
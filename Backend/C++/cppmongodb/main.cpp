@@ -1,28 +1,44 @@
 #include "include/crow.h"   // Crow single-header (download from https://github.com/ipkn/crow)
-#include <mongocxx/client.hpp>
 #include <mongocxx/instance.hpp>
-#include <mongocxx/uri.hpp>
-#include <bsoncxx/json.hpp>
-#include <bsoncxx/builder/stream/document.hpp>
-#include <mutex>
-#include <sstream>
+#include <cstdlib>
+#include <memory>
+#include <string>
 #include <vector>
 #include <boost/asio.hpp>
 
-// For convenience in building BSON documents.
-using namespace bsoncxx::builder::stream;
+#include "mongo_repository.h"
+#include "../common/memory_repository.h"
 
-std::mutex mongo_mutex;
-
-// Initialize the MongoDB C++ driver instance and client.
-// The instance must be created before using any MongoDB operations.
+// The MongoDB C++ driver instance must be created before using any MongoDB
+// operations.
+const std::string mongo_uri = "mongodb://localhost:27017";
 mongocxx::instance instance{};
-mongocxx::client mongo_client{mongocxx::uri{"mongodb://localhost:27017"}};
-// Obtain the "lists" collection from the "listdb" database.
-auto list_collection = mongo_client["listdb"]["lists"];
 
-int main()
+// Where the lists live; chosen in main(). mongo_lists is set too when it is
+// MongoDB, for the cached GET /lists fast path.
+std::unique_ptr<ListRepository> repository;
+MongoListRepository* mongo_lists = nullptr;
+
+crow::json::wvalue list_json(const ListItem& item)
+{
+    crow::json::wvalue result;
+    result["_id"] = item.id;
+    result["list"] = item.list;
+    return result;
+}
+
+int main(int argc, char* argv[])
 {
+    // `list_api --memory` keeps the lists in process memory instead of
+    // MongoDB, to measure the HTTP stack on its own.
+    if (argc > 1 && std::string(argv[1]) == "--memory") {
+        repository = std::make_unique<MemoryListRepository>();
+    } else {
+        auto mongo = std::make_unique<MongoListRepository>(mongo_uri);
+        mongo_lists = mongo.get();
+        repository = std::move(mongo);
+    }
+
     crow::SimpleApp app;
 
     // OPTIONS route for CORS (preflight requests)
@@ -38,147 +54,115 @@ int main()
 
     // POST /lists – Create a new list item.
     CROW_ROUTE(app, "/lists").methods("POST"_method)
-    ([](const crow::request& req) {
+    ([](const crow::request& req) -> crow::task<crow::response> {
         auto body = crow::json::load(req.body);
         if (!body)
-            return crow::response(400, "Invalid JSON");
+            co_return crow::response(400, "Invalid JSON");
         if (!body.has("list"))
-            return crow::response(400, "Missing 'list' field");
+            co_return crow::response(400, "Missing 'list' field");
 
         std::string list_val = body["list"].s();
         crow::json::wvalue result;
 
         try {
-            std::lock_guard<std::mutex> lock(mongo_mutex);
-            // Build BSON document with the new list item.
-            auto doc = document{} << "list" << list_val << finalize;
-            auto insert_result = list_collection.insert_one(doc.view());
-            if (insert_result) {
-                // Retrieve the inserted _id as a string.
-                auto id = insert_result->inserted_id().get_oid().value.to_string();
-                result["_id"] = id;
-                result["list"] = list_val;
-            }
+            result = list_json(co_await repository->create(req, list_val));
         } catch (const std::exception &e) {
-            return crow::response(500, std::string("Database error: ") + e.what());
+            co_return crow::response(500, std::string("Database error: ") + e.what());
         }
 
         crow::response res(result);
         res.code = 201;
-        return res;
+        co_return res;
     });
 
     // GET /lists – Retrieve all list items.
     CROW_ROUTE(app, "/lists").methods("GET"_method)
-    ([]() {
+    ([](const crow::request& req) -> crow::task<crow::response> {
+        if (mongo_lists) {
+            if (auto json = mongo_lists->cached_json())
+                co_return crow::response("application/json", *json);
+        }
+
         std::vector<crow::json::wvalue> items;
         try {
-            std::lock_guard<std::mutex> lock(mongo_mutex);
-            auto cursor = list_collection.find({});
-            for (auto&& doc : cursor) {
-                crow::json::wvalue item;
-                // Convert ObjectId to string.
-                item["_id"] = doc["_id"].get_oid().value.to_string();
-                if (doc["list"] && doc["list"].type() == bsoncxx::type::k_utf8) {
-                    item["list"] = std::string(doc["list"].get_utf8().value.to_string());
-                } else {
-                    item["list"] = "";
-                }
-                items.push_back(std::move(item));
-            }
+            for (const auto &item : co_await repository->all(req))
+                items.push_back(list_json(item));
         } catch (const std::exception &e) {
-            return crow::response(500, std::string("Database error: ") + e.what());
+            co_return crow::response(500, std::string("Database error: ") + e.what());
         }
         // Build a JSON array from the vector.
         crow::json::wvalue result(std::move(items));
         crow::response res(result);
-        return res;
+        co_return res;
     });
 
     // GET /lists/<id> – Retrieve a specific list item.
     CROW_ROUTE(app, "/lists/<string>").methods("GET"_method)
-    ([](std::string id_str) {
+    ([](const crow::request& req, std::string id_str) -> crow::task<crow::response> {
         crow::json::wvalue result;
         try {
-            std::lock_guard<std::mutex> lock(mongo_mutex);
-            // Convert the string to a bsoncxx::oid.
-            bsoncxx::oid id(id_str);
-            auto filter = document{} << "_id" << id << finalize;
-            auto maybe_doc = list_collection.find_one(filter.view());
-            if (maybe_doc) {
-                auto doc = maybe_doc->view();
-                result["_id"] = doc["_id"].get_oid().value.to_string();
-                if (doc["list"] && doc["list"].type() == bsoncxx::type::k_utf8) {
-                    result["list"] = std::string(doc["list"].get_utf8().value.to_string());
-                } else {
-                    result["list"] = "";
-                }
-            } else {
-                return crow::response(404, "Item not found");
-            }
+            auto item = co_await repository->get(req, id_str);
+            if (!item)
+                co_return crow::response(404, "Item not found");
+            result = list_json(*item);
         } catch (const std::exception &e) {
-            return crow::response(500, std::string("Database error: ") + e.what());
+            co_return crow::response(500, std::string("Database error: ") + e.what());
         }
         crow::response res(result);
-        return res;
+        co_return res;
     });
 
     // PUT /lists/<id> – Update a specific list item.
     CROW_ROUTE(app, "/lists/<string>").methods("PUT"_method)
-    ([](const crow::request& req, std::string id_str) {
+    ([](const crow::request& req, std::string id_str) -> crow::task<crow::response> {
         auto body = crow::json::load(req.body);
         if (!body)
-            return crow::response(400, "Invalid JSON");
+            co_return crow::response(400, "Invalid JSON");
         if (!body.has("list"))
-            return crow::response(400, "Missing 'list' field");
+            co_return crow::response(400, "Missing 'list' field");
 
         std::string new_list = body["list"].s();
         crow::json::wvalue result;
         try {
-            std::lock_guard<std::mutex> lock(mongo_mutex);
-            bsoncxx::oid id(id_str);
-            auto filter = document{} << "_id" << id << finalize;
-            auto update = document{} << "$set" << open_document << "list" << new_list << close_document << finalize;
-            auto update_result = list_collection.update_one(filter.view(), update.view());
-            if (update_result && update_result->modified_count() == 1) {
-                // Retrieve and return the updated document.
-                auto maybe_doc = list_collection.find_one(filter.view());
-                if (maybe_doc) {
-                    auto doc = maybe_doc->view();
-                    result["_id"] = doc["_id"].get_oid().value.to_string();
-                    if (doc["list"] && doc["list"].type() == bsoncxx::type::k_utf8) {
-                        result["list"] = std::string(doc["list"].get_utf8().value.to_string());
-                    } else {
-                        result["list"] = "";
-                    }
-                }
-            } else {
-                return crow::response(404, "Item not found");
-            }
+            auto item = co_await repository->update(req, id_str, new_list);
+            if (!item)
+                co_return crow::response(404, "Item not found");
+            result = list_json(*item);
         } catch (const std::exception &e) {
-            return crow::response(500, std::string("Database error: ") + e.what());
+            co_return crow::response(500, std::string("Database error: ") + e.what());
         }
         crow::response res(result);
-        return res;
+        co_return res;
     });
 
     // DELETE /lists/<id> – Delete a specific list item.
     CROW_ROUTE(app, "/lists/<string>").methods("DELETE"_method)
-    ([](std::string id_str) {
+    ([](const crow::request& req, std::string id_str) -> crow::task<crow::response> {
         try {
-            std::lock_guard<std::mutex> lock(mongo_mutex);
-            bsoncxx::oid id(id_str);
-            auto filter = document{} << "_id" << id << finalize;
-            auto del_result = list_collection.delete_one(filter.view());
-            if (del_result && del_result->deleted_count() == 1)
-                return crow::response(200, "Item deleted");
+            if (co_await repository->remove(req, id_str))
+                co_return crow::response(200, "Item deleted");
             else
-                return crow::response(404, "Item not found");
+                co_return crow::response(404, "Item not found");
         } catch (const std::exception &e) {
-            return crow::response(500, std::string("Database error: ") + e.what());
+            co_return crow::response(500, std::string("Database error: ") + e.what());
         }
     });
 
+    // LIST_API_SOCKET=/run/list_api.sock serves a reverse proxy on the same host
+    // through a Unix domain socket instead of TCP port 3000.
+    if (const char* socket_path = std::getenv("LIST_API_SOCKET"))
+        app.local_socket_path(socket_path);
+
+    // LIST_API_PIN_THREADS=1 pins every io thread to its own CPU, filling one
+    // NUMA node before the next.
+    if (std::getenv("LIST_API_PIN_THREADS"))
+        app.pin_io_threads();
+
+    // LIST_API_PER_CORE=1 gives every io thread its own listening socket
+    // (SO_REUSEPORT) and serves each connection on the thread that accepted it.
+    if (std::getenv("LIST_API_PER_CORE"))
+        app.per_core();
+
     app.port(3000).multithreaded().run();
     return 0;
 }
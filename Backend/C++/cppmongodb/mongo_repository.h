@@ -0,0 +1,173 @@
+#pragma once
+
+#include <mongocxx/client.hpp>
+#include <mongocxx/client_session.hpp>
+#include <mongocxx/pool.hpp>
+#include <mongocxx/uri.hpp>
+#include <bsoncxx/builder/stream/document.hpp>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../common/list_repository.h"
+#include "list_cache.h"
+
+// Lists in the "lists" collection of the "listdb" database.
+//
+// A mongocxx::client must not be shared between threads, so every task
+// borrows one from the pool for the duration of its operation. Blocking driver
+// calls run on an executor instead of Crow's io threads, so a slow query only
+// holds up its own request. Reads are served from the ListCache without
+// suspending while its change stream is live, and a write only resumes its
+// handler once the stream has brought the change into the cache.
+class MongoListRepository : public ListRepository
+{
+public:
+    explicit MongoListRepository(const std::string& uri, size_t threads = 8):
+      pool_(mongocxx::uri{uri}), executor_(threads), cache_(uri)
+    {
+        cache_.start();
+    }
+
+    /// The JSON array for GET /lists, straight from the cache; nullptr while the cache is not live.
+    std::shared_ptr<const std::string> cached_json() const
+    {
+        if (!cache_.ready())
+            return nullptr;
+        return cache_.snapshot();
+    }
+
+private:
+    // Awaitable collection access: borrows a pooled client in the executor,
+    // runs f(collection) and resumes the calling handler on its io thread with
+    // the result. f must return owned data; views die with the client.
+    template<typename Func>
+    auto with_lists(const crow::request& req, Func f)
+    {
+        return executor_.async(req, [this, f = std::move(f)] {
+            auto client = pool_.acquire();
+            // Obtain the "lists" collection from the "listdb" database.
+            auto list_collection = (*client)["listdb"]["lists"];
+            return f(list_collection);
+        });
+    }
+
+    // Like with_lists for a write: f(collection, session) makes it in a session.
+    // If it changed anything, the executor thread then waits for the cache to
+    // apply it, so that this instance reads its own write from the cache too.
+    template<typename Func>
+    auto write_lists(const crow::request& req, Func f)
+    {
+        return executor_.async(req, [this, f = std::move(f)] {
+            auto client = pool_.acquire();
+            auto list_collection = (*client)["listdb"]["lists"];
+            auto session = client->start_session();
+            auto result = f(list_collection, session);
+            if (changed(result) && !cache_.wait_for(session.operation_time()))
+                CROW_LOG_WARNING << "List cache is behind a write, reads may not see it yet";
+            return result;
+        });
+    }
+
+public:
+    crow::task<ListItem> create(const crow::request& req, std::string list) override
+    {
+        using namespace bsoncxx::builder::stream;
+        auto id = co_await write_lists(req, [list](mongocxx::collection& list_collection, mongocxx::client_session& session) {
+            // Build BSON document with the new list item.
+            auto doc = document{} << "list" << list << finalize;
+            auto insert_result = list_collection.insert_one(session, doc.view());
+            if (!insert_result)
+                throw std::runtime_error("insert was not acknowledged");
+            // Retrieve the inserted _id as a string.
+            return insert_result->inserted_id().get_oid().value.to_string();
+        });
+        co_return ListItem{std::move(id), std::move(list)};
+    }
+
+    crow::task<std::vector<ListItem>> all(const crow::request& req) override
+    {
+        co_return co_await with_lists(req, [](mongocxx::collection& list_collection) {
+            std::vector<ListItem> items;
+            auto cursor = list_collection.find({});
+            for (auto&& doc : cursor)
+                // Convert ObjectId to string.
+                items.push_back(ListItem{doc["_id"].get_oid().value.to_string(), list_of(doc)});
+            return items;
+        });
+    }
+
+    crow::task<std::optional<ListItem>> get(const crow::request& req, std::string id_str) override
+    {
+        using namespace bsoncxx::builder::stream;
+        // Convert the string to a bsoncxx::oid; throws on a malformed id.
+        bsoncxx::oid id(id_str);
+        if (cache_.ready())
+        {
+            auto cached = cache_.get(id_str);
+            if (!cached)
+                co_return std::nullopt;
+            co_return ListItem{std::move(id_str), std::move(*cached)};
+        }
+
+        co_return co_await with_lists(req, [id](mongocxx::collection& list_collection) -> std::optional<ListItem> {
+            auto filter = document{} << "_id" << id << finalize;
+            auto maybe_doc = list_collection.find_one(filter.view());
+            if (!maybe_doc)
+                return std::nullopt;
+            auto doc = maybe_doc->view();
+            return ListItem{doc["_id"].get_oid().value.to_string(), list_of(doc)};
+        });
+    }
+
+    crow::task<std::optional<ListItem>> update(const crow::request& req, std::string id_str, std::string list) override
+    {
+        using namespace bsoncxx::builder::stream;
+        bsoncxx::oid id(id_str);
+        co_return co_await write_lists(req, [id, list](mongocxx::collection& list_collection, mongocxx::client_session& session) -> std::optional<ListItem> {
+            auto filter = document{} << "_id" << id << finalize;
+            auto update = document{} << "$set" << open_document << "list" << list << close_document << finalize;
+            auto update_result = list_collection.update_one(session, filter.view(), update.view());
+            if (!update_result || update_result->modified_count() != 1)
+                return std::nullopt;
+            // Retrieve and return the updated document (outside the session,
+            // whose operationTime stays that of the update).
+            auto maybe_doc = list_collection.find_one(filter.view());
+            if (!maybe_doc)
+                return std::nullopt;
+            auto doc = maybe_doc->view();
+            return ListItem{doc["_id"].get_oid().value.to_string(), list_of(doc)};
+        });
+    }
+
+    crow::task<bool> remove(const crow::request& req, std::string id_str) override
+    {
+        using namespace bsoncxx::builder::stream;
+        bsoncxx::oid id(id_str);
+        co_return co_await write_lists(req, [id](mongocxx::collection& list_collection, mongocxx::client_session& session) {
+            auto filter = document{} << "_id" << id << finalize;
+            auto del_result = list_collection.delete_one(session, filter.view());
+            return del_result && del_result->deleted_count() == 1;
+        });
+    }
+
+private:
+    // Whether the result of a write means the collection changed.
+    static bool changed(const std::string&) { return true; }
+    static bool changed(const std::optional<ListItem>& item) { return item.has_value(); }
+    static bool changed(bool deleted) { return deleted; }
+
+    static std::string list_of(const bsoncxx::document::view& doc)
+    {
+        if (doc["list"] && doc["list"].type() == bsoncxx::type::k_utf8)
+            return std::string(doc["list"].get_utf8().value.to_string());
+        return "";
+    }
+
+    mongocxx::pool pool_;
+    crow::executor executor_;
+    // Reads are served from here while its change stream is live.
+    ListCache cache_;
+};
@@ -207,6 +207,10 @@ namespace crow
 #ifdef CROW_ENABLE_SSL
         /// \brief An HTTP server that runs on SSL with an SSLAdaptor
         using ssl_server_t = Server<Crow, SSLAdaptor, Middlewares...>;
+#endif
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        /// \brief An HTTP server that listens on a Unix domain socket
+        using unix_server_t = Server<Crow, UnixSocketAdaptor, Middlewares...>;
 #endif
         Crow()
         {}
@@ -310,6 +314,12 @@ namespace crow
             {
                 return port_;
             }
+#ifdef CROW_HAS_LOCAL_SOCKETS
+            if (unix_server_)
+            {
+                return unix_server_->port();
+            }
+#endif
 #ifdef CROW_ENABLE_SSL
             if (ssl_used_)
             {
@@ -349,6 +359,34 @@ namespace crow
             return bindaddr_;
         }
 
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        /// \brief Listen on a Unix domain socket at this path instead of the TCP port
+        ///
+        /// A socket file left behind by a server that is no longer running is replaced, and the file is removed again
+        /// when the server is destroyed. Meant for a reverse proxy on the same host, so SSL and \ref reuse_port() are
+        /// not used on it.
+        self_t& local_socket_path(std::string path)
+        {
+            local_socket_path_ = path;
+            return *this;
+        }
+
+        /// \brief Get the path of the Unix domain socket (empty when Crow listens on TCP)
+        std::string local_socket_path() const
+        {
+            return local_socket_path_;
+        }
+
+        /// \brief Set the permissions of the Unix domain socket file (default is 0660, owner and group)
+        ///
+        /// Connecting needs write permission on the file, so this decides which users may send requests.
+        self_t& local_socket_permissions(unsigned mode)
+        {
+            local_socket_permissions_ = mode;
+            return *this;
+        }
+#endif
+
         /// \brief Run the server on multiple threads using all available threads
         self_t& multithreaded()
         {
@@ -370,6 +408,70 @@ namespace crow
             return concurrency_;
         }
 
+        /// \brief Give every io thread its own listening socket (SO_REUSEPORT)
+        ///
+        /// The kernel then spreads new connections over the io threads, instead of one acceptor handing them out.
+        /// Falls back to a single acceptor where SO_REUSEPORT is not available. A port that another server already
+        /// listens on still fails startup, even if that server uses SO_REUSEPORT too.
+        self_t& reuse_port(bool enabled = true)
+        {
+            reuse_port_ = enabled;
+            return *this;
+        }
+
+        /// \brief Shared-nothing mode: every io thread accepts and serves its own connections
+        ///
+        /// Each io thread gets its own listening socket (see \ref reuse_port()) and an io_context created with a
+        /// concurrency hint of 1, so nothing on the request path is shared with the other threads apart from the
+        /// router and the middlewares. Per-thread resources go into the thread's \ref core_context, see
+        /// \ref on_core_start(). Unix domain sockets keep their single acceptor.
+        self_t& per_core(bool enabled = true)
+        {
+            per_core_ = enabled;
+            return *this;
+        }
+
+        /// \brief Run a function on every io thread before it serves connections
+        ///
+        /// Meant to put the thread's own resources (a database connection, a cache shard) into its
+        /// \ref core_context, where handlers find them through \ref this_core().
+        self_t& on_core_start(std::function<void(core_context&)> f)
+        {
+            core_start_function_ = std::move(f);
+            return *this;
+        }
+
+        /// \brief Pin every io thread to its own CPU
+        ///
+        /// Io thread i runs on `cpus[i % cpus.size()]`. Without a list the CPUs this process may use are taken in NUMA
+        /// node order, so the io threads fill one node before the next. A pinned thread's io_context and timers are
+        /// allocated on its own node, and so are its connections when they are accepted by the thread itself (see
+        /// \ref reuse_port()).
+        self_t& pin_io_threads(std::vector<int> cpus = {})
+        {
+            pin_io_threads_ = true;
+            io_thread_cpus_ = std::move(cpus);
+            return *this;
+        }
+
+        /// \brief Keep one CPU for the thread that runs the acceptor and the tick timer
+        ///
+        /// That thread is pinned to `cpu`, which is then left out when \ref pin_io_threads() picks the CPUs itself.
+        self_t& housekeeping_cpu(int cpu)
+        {
+            housekeeping_cpu_ = cpu;
+            return *this;
+        }
+
+        /// \brief Choose how new connections are spread over the io threads (default is least connections)
+        ///
+        /// Has no effect together with \ref reuse_port(), where the kernel spreads connections.
+        self_t& placement(placement_strategy strategy)
+        {
+            placement_ = strategy;
+            return *this;
+        }
+
         /// \brief Set the server's log level
         ///
         /// Possible values are:
@@ -506,6 +608,30 @@ namespace crow
 #endif
             validate();
 
+#ifdef CROW_HAS_LOCAL_SOCKETS
+            if (!local_socket_path_.empty())
+            {
+#ifdef CROW_ENABLE_SSL
+                if (ssl_used_)
+                    CROW_LOG_WARNING << "SSL is not used on the Unix domain socket " << local_socket_path_;
+                ssl_used_ = false;
+#endif
+                unix_server_ = std::unique_ptr<unix_server_t>(new unix_server_t(this, asio::local::stream_protocol::endpoint(local_socket_path_), server_name_, &middlewares_, concurrency_, timeout_, nullptr, false, local_socket_permissions_));
+                unix_server_->set_tick_function(tick_interval_, tick_function_);
+                unix_server_->set_placement_strategy(placement_);
+                unix_server_->set_thread_affinity(pin_io_threads_, io_thread_cpus_, housekeeping_cpu_);
+                unix_server_->set_per_core(per_core_);
+                unix_server_->set_core_start_function(core_start_function_);
+                for (auto snum : signals_)
+                {
+                    unix_server_->signal_add(snum);
+                }
+                notify_server_start();
+                unix_server_->run();
+                return;
+            }
+#endif
+
             error_code ec;
             asio::ip::address addr = asio::ip::make_address(bindaddr_,ec);
             if (ec){
@@ -517,8 +643,12 @@ namespace crow
             if (ssl_used_)
             {
                 router_.using_ssl = true;
-                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, &ssl_context_)));
+                ssl_server_ = std::move(std::unique_ptr<ssl_server_t>(new ssl_server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, &ssl_context_, reuse_port_ || per_core_)));
                 ssl_server_->set_tick_function(tick_interval_, tick_function_);
+                ssl_server_->set_placement_strategy(placement_);
+                ssl_server_->set_thread_affinity(pin_io_threads_, io_thread_cpus_, housekeeping_cpu_);
+                ssl_server_->set_per_core(per_core_);
+                ssl_server_->set_core_start_function(core_start_function_);
                 ssl_server_->signal_clear();
                 for (auto snum : signals_)
                 {
@@ -530,8 +660,12 @@ namespace crow
             else
 #endif
             {
-                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, nullptr)));
+                server_ = std::move(std::unique_ptr<server_t>(new server_t(this, endpoint, server_name_, &middlewares_, concurrency_, timeout_, nullptr, reuse_port_ || per_core_)));
                 server_->set_tick_function(tick_interval_, tick_function_);
+                server_->set_placement_strategy(placement_);
+                server_->set_thread_affinity(pin_io_threads_, io_thread_cpus_, housekeeping_cpu_);
+                server_->set_per_core(per_core_);
+                server_->set_core_start_function(core_start_function_);
                 for (auto snum : signals_)
                 {
                     server_->signal_add(snum);
@@ -571,6 +705,9 @@ namespace crow
                     websocket->close("Server Application Terminated");
                 }
                 if (server_) { server_->stop(); }
+#ifdef CROW_HAS_LOCAL_SOCKETS
+                if (unix_server_) { unix_server_->stop(); }
+#endif
             }
         }
 
@@ -725,6 +862,12 @@ namespace crow
                 {
                     status = ssl_server_->wait_for_start(wait_until);
                 }
+#endif
+#ifdef CROW_HAS_LOCAL_SOCKETS
+                else if (unix_server_)
+                {
+                    status = unix_server_->wait_for_start(wait_until);
+                }
 #endif
             }
             return status;
@@ -760,9 +903,20 @@ namespace crow
         std::uint8_t timeout_{5};
         uint16_t port_ = 80;
         uint16_t concurrency_ = 2;
+        bool reuse_port_{false};
+        bool per_core_{false};
+        std::function<void(core_context&)> core_start_function_;
+        bool pin_io_threads_{false};
+        std::vector<int> io_thread_cpus_;
+        int housekeeping_cpu_{-1};
+        placement_strategy placement_{placement_strategy::least_connections};
         uint64_t max_payload_{UINT64_MAX};
         std::string server_name_ = std::string("Crow/") + VERSION;
         std::string bindaddr_ = "0.0.0.0";
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        std::string local_socket_path_;
+        unsigned local_socket_permissions_{0660};
+#endif
         size_t res_stream_threshold_ = 1048576;
         Router router_;
         bool static_routes_added_{false};
@@ -784,6 +938,9 @@ namespace crow
 #endif
 
         std::unique_ptr<server_t> server_;
+#ifdef CROW_HAS_LOCAL_SOCKETS
+        std::unique_ptr<unix_server_t> unix_server_;
+#endif
 
         std::vector<int> signals_{SIGINT, SIGTERM};
 
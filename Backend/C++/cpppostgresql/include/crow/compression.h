@@ -56,6 +56,36 @@ namespace crow // NOTE: Already documented in "crow/app.h"
             return compressed_str;
         }
 
+        /// Compress a response body with the app's algorithm, if the response allows it and the client accepts it.
+        template<typename Handler, typename Request, typename Response>
+        void compress_response(Handler& handler, const Request& req, Response& res)
+        {
+            if (res.body.empty() || !handler.compression_used() || !res.compressed)
+                return;
+            std::string accept_encoding = req.get_header_value("Accept-Encoding");
+            if (accept_encoding.empty())
+                return;
+            switch (handler.compression_algorithm())
+            {
+                case DEFLATE:
+                    if (accept_encoding.find("deflate") != std::string::npos)
+                    {
+                        res.body = compress_string(res.body, DEFLATE);
+                        res.set_header("Content-Encoding", "deflate");
+                    }
+                    break;
+                case GZIP:
+                    if (accept_encoding.find("gzip") != std::string::npos)
+                    {
+                        res.body = compress_string(res.body, GZIP);
+                        res.set_header("Content-Encoding", "gzip");
+                    }
+                    break;
+                default:
+                    break;
+            }
+        }
+
         inline std::string decompress_string(std::string const& deflated_string)
         {
             std::string inflated_string;
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "crow/settings.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// Closed connections of one io thread, kept to serve the next clients of that thread.
+
+        ///
+        /// Saves allocating (and first touching) a connection with its buffers and parser for every accepted socket.
+        /// A connection comes back when its last shared_ptr goes away, which may happen on any thread (e.g. a handler
+        /// finishing on an executor), so the free list is guarded by a mutex that only the owning thread normally takes.
+        template<typename Connection>
+        class connection_pool
+        {
+        public:
+            explicit connection_pool(std::size_t capacity = CROW_CONNECTION_POOL_SIZE):
+              capacity_(capacity)
+            {}
+
+            connection_pool(const connection_pool&) = delete;
+            connection_pool& operator=(const connection_pool&) = delete;
+
+            ~connection_pool()
+            {
+                clear();
+            }
+
+            /// Delete the kept connections and stop keeping any, e.g. before their io_context goes away.
+            void clear()
+            {
+                std::vector<Connection*> connections;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    capacity_ = 0;
+                    connections.swap(free_);
+                }
+                for (Connection* connection : connections)
+                    delete connection;
+            }
+
+            /// A recycled connection, or a new one made from `args` when there is none.
+
+            ///
+            /// Recycled connections were made with the arguments of an earlier call, so every call has to pass the
+            /// same ones (as all connections of one io thread do).
+            template<typename... Args>
+            std::shared_ptr<Connection> acquire(Args&&... args)
+            {
+                Connection* connection = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (!free_.empty())
+                    {
+                        connection = free_.back();
+                        free_.pop_back();
+                    }
+                }
+                if (connection)
+                    connection->reuse();
+                else
+                    connection = new Connection(std::forward<Args>(args)...);
+                return std::shared_ptr<Connection>(connection, [this](Connection* c) {
+                    release(c);
+                });
+            }
+
+        private:
+            void release(Connection* connection) noexcept
+            {
+                try
+                {
+                    if (has_room())
+                    {
+                        connection->recycle();
+                        std::lock_guard<std::mutex> lock(mutex_);
+                        if (free_.size() < capacity_)
+                        {
+                            free_.push_back(connection);
+                            return;
+                        }
+                    }
+                }
+                catch (...)
+                {}
+                delete connection;
+            }
+
+            bool has_room()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                return free_.size() < capacity_;
+            }
+
+            std::size_t capacity_;
+            std::mutex mutex_;
+            std::vector<Connection*> free_;
+        };
+
+        /// Read buffers of one io thread, lent to its connections only while they have received bytes to parse.
+
+        ///
+        /// An idle keep-alive connection waits for the socket to become readable without holding a buffer, so memory
+        /// for reads grows with the number of busy connections rather than open ones. Only used from the io thread
+        /// that owns it, so it needs no locking.
+        class read_buffer_pool
+        {
+        public:
+            static constexpr std::size_t buffer_size = 4096;
+            using buffer = std::array<char, buffer_size>;
+
+            std::unique_ptr<buffer> acquire()
+            {
+                if (free_.empty())
+                    return std::unique_ptr<buffer>(new buffer);
+                auto b = std::move(free_.back());
+                free_.pop_back();
+                return b;
+            }
+
+            void release(std::unique_ptr<buffer> b)
+            {
+                if (free_.size() < CROW_READ_BUFFER_POOL_SIZE)
+                    free_.push_back(std::move(b));
+            }
+
+            /// The pool of the calling thread.
+            static read_buffer_pool& local()
+            {
+                static thread_local read_buffer_pool pool;
+                return pool;
+            }
+
+        private:
+            std::vector<std::unique_ptr<buffer>> free_;
+        };
+    } // namespace detail
+} // namespace crow
@@ -0,0 +1,439 @@
+#pragma once
+
+#include "crow/settings.h"
+
+#ifdef CROW_USE_BOOST
+#include <boost/asio.hpp>
+#else
+#ifndef ASIO_STANDALONE
+#define ASIO_STANDALONE
+#endif
+#include <asio.hpp>
+#endif
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "crow/http_request.h"
+#include "crow/http_response.h"
+#include "crow/logging.h"
+
+#ifdef CROW_CAN_USE_COROUTINES
+#include <coroutine>
+#endif
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+#ifdef CROW_USE_BOOST
+    namespace asio = boost::asio;
+#endif
+
+    namespace detail
+    {
+        /// A type erased, move-only `void()` callable.
+
+        ///
+        /// `std::function` requires copyable targets, which rules out handlers that own a `crow::response`.
+        class unique_task
+        {
+        public:
+            unique_task() = default;
+
+            template<typename Func, typename = typename std::enable_if<!std::is_same<typename std::decay<Func>::type, unique_task>::value>::type>
+            unique_task(Func&& f):
+              impl_(new model<typename std::decay<Func>::type>(std::forward<Func>(f)))
+            {}
+
+            void operator()()
+            {
+                impl_->call();
+            }
+
+            explicit operator bool() const
+            {
+                return static_cast<bool>(impl_);
+            }
+
+        private:
+            struct concept_t
+            {
+                virtual ~concept_t() {}
+                virtual void call() = 0;
+            };
+
+            template<typename Func>
+            struct model : concept_t
+            {
+                model(Func&& f):
+                  f_(std::move(f))
+                {}
+                model(const Func& f):
+                  f_(f)
+                {}
+                void call() override
+                {
+                    f_();
+                }
+                Func f_;
+            };
+
+            std::unique_ptr<concept_t> impl_;
+        };
+
+        /// Bounded multi-producer multi-consumer queue (Dmitry Vyukov's design).
+
+        ///
+        /// Every slot carries a sequence number that tells producers and consumers whether it is theirs to use,
+        /// so a push or pop is a single CAS on the shared index plus one store, with no locks.
+        /// The capacity is rounded up to a power of two.
+        template<typename T>
+        class mpmc_queue
+        {
+        public:
+            explicit mpmc_queue(size_t capacity)
+            {
+                size_t size = 2;
+                while (size < capacity)
+                    size <<= 1;
+                mask_ = size - 1;
+                cells_.reset(new cell[size]);
+                for (size_t i = 0; i < size; i++)
+                    cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+
+            mpmc_queue(const mpmc_queue&) = delete;
+            mpmc_queue& operator=(const mpmc_queue&) = delete;
+
+            size_t capacity() const
+            {
+                return mask_ + 1;
+            }
+
+            /// Returns false if the queue is full. `value` is left untouched in that case.
+            bool try_push(T& value)
+            {
+                cell* c;
+                size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    c = &cells_[pos & mask_];
+                    size_t seq = c->sequence.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+                    if (diff == 0)
+                    {
+                        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                            break;
+                    }
+                    else if (diff < 0)
+                        return false;
+                    else
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+                c->data = std::move(value);
+                c->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            /// Returns false if the queue is empty.
+            bool try_pop(T& value)
+            {
+                cell* c;
+                size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+                for (;;)
+                {
+                    c = &cells_[pos & mask_];
+                    size_t seq = c->sequence.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+                    if (diff == 0)
+                    {
+                        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                            break;
+                    }
+                    else if (diff < 0)
+                        return false;
+                    else
+                        pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+                value = std::move(c->data);
+                c->sequence.store(pos + mask_ + 1, std::memory_order_release);
+                return true;
+            }
+
+        private:
+            static constexpr size_t cache_line = 64;
+
+            struct cell
+            {
+                std::atomic<size_t> sequence;
+                T data;
+            };
+
+            std::unique_ptr<cell[]> cells_;
+            size_t mask_;
+            alignas(cache_line) std::atomic<size_t> enqueue_pos_{0};
+            alignas(cache_line) std::atomic<size_t> dequeue_pos_{0};
+        };
+    } // namespace detail
+
+    /// Thrown (or answered with a 503) when an executor's queue is full.
+    struct executor_full : std::runtime_error
+    {
+        executor_full():
+          std::runtime_error("executor queue is full")
+        {}
+    };
+
+#ifdef CROW_CAN_USE_COROUTINES
+    class executor;
+
+    namespace detail
+    {
+        /// The awaitable returned by \ref executor::async().
+        template<typename Func>
+        class executor_awaitable
+        {
+        public:
+            using result_type = typename std::invoke_result<Func&>::type;
+
+            executor_awaitable(executor& ex, asio::io_context* io_context, Func work):
+              executor_(ex), io_context_(io_context), work_(std::move(work))
+            {}
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            bool await_suspend(std::coroutine_handle<> awaiting);
+
+            result_type await_resume()
+            {
+                if (error_)
+                    std::rethrow_exception(error_);
+                if constexpr (!std::is_void<result_type>::value)
+                    return std::move(*result_);
+            }
+
+        private:
+            struct empty
+            {};
+            using storage_type = typename std::conditional<std::is_void<result_type>::value, empty, result_type>::type;
+
+            executor& executor_;
+            asio::io_context* io_context_;
+            Func work_;
+            std::optional<storage_type> result_;
+            std::exception_ptr error_;
+        };
+    } // namespace detail
+#endif
+
+    /// A fixed pool of threads for blocking work (database drivers, file IO, etc...).
+
+    ///
+    /// Route handlers run on the server's io threads. A handler that blocks there stalls every other connection
+    /// owned by the same thread. Submitting the blocking part to an executor keeps io threads free to parse and write
+    /// while the work runs; the result is posted back to the io_context of the request's own connection.
+    ///
+    /// Tasks go through a bounded lock-free queue. Once it is full, submissions are refused instead of piling up, and
+    /// \ref run() answers `503 Service Unavailable`.
+    class executor
+    {
+    public:
+        /// \param threads Number of worker threads.
+        /// \param capacity Maximum number of tasks waiting for a worker.
+        explicit executor(size_t threads = std::thread::hardware_concurrency(), size_t capacity = 1024):
+          queue_(capacity)
+        {
+            if (threads == 0)
+                threads = 1;
+            workers_.reserve(threads);
+            for (size_t i = 0; i < threads; i++)
+                workers_.emplace_back([this] {
+                    worker_loop();
+                });
+        }
+
+        executor(const executor&) = delete;
+        executor& operator=(const executor&) = delete;
+
+        /// Finish the tasks already queued, then join the workers.
+        ~executor()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                stopping_ = true;
+            }
+            cv_.notify_all();
+            for (auto& worker : workers_)
+                worker.join();
+        }
+
+        size_t thread_count() const
+        {
+            return workers_.size();
+        }
+
+        /// Queue a task for a worker thread. Returns false (and drops the task) if the queue is full.
+        template<typename Func>
+        bool try_submit(Func&& f)
+        {
+            detail::unique_task task(std::forward<Func>(f));
+            // Counted before the push so that pending_ never under-reports what a worker can pop.
+            pending_.fetch_add(1);
+            if (!queue_.try_push(task))
+            {
+                pending_.fetch_sub(1);
+                return false;
+            }
+            if (sleepers_.load() > 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                cv_.notify_one();
+            }
+            return true;
+        }
+
+        /// Run `work` on a worker thread and send the `crow::response` it returns.
+
+        ///
+        /// `res.end()` is called on the io thread that owns the connection, never on the worker.
+        /// `req` stays valid until `res` has been ended, so `work` may read from it.
+        /// If `work` throws, a 500 is sent. If the queue is full, a 503 is sent immediately.
+        template<typename Func>
+        void run(const request& req, response& res, Func&& work)
+        {
+            asio::io_context* io_context = req.io_context;
+            bool queued = try_submit([io_context, &res, work = std::forward<Func>(work)]() mutable {
+                response result;
+                try
+                {
+                    result = response(work());
+                }
+                catch (const std::exception& e)
+                {
+                    CROW_LOG_ERROR << "An uncaught exception occurred in an executor task: " << e.what();
+                    result = response(500);
+                }
+                catch (...)
+                {
+                    CROW_LOG_ERROR << "An uncaught exception occurred in an executor task. The type was unknown so no information was available.";
+                    result = response(500);
+                }
+                complete(io_context, res, std::move(result));
+            });
+            if (!queued)
+            {
+                CROW_LOG_WARNING << "Executor queue is full, rejecting request " << req.url;
+                res = response(503);
+                res.end();
+            }
+        }
+
+#ifdef CROW_CAN_USE_COROUTINES
+        /// Run `work` on a worker thread from a coroutine handler: `auto rows = co_await pool.async(req, [] { ... });`
+
+        ///
+        /// The coroutine is resumed on the io thread that owns the request's connection, with whatever `work` returned.
+        /// An exception thrown by `work` is rethrown at the `co_await`; if the queue is full, \ref executor_full is thrown there.
+        template<typename Func>
+        detail::executor_awaitable<typename std::decay<Func>::type> async(const request& req, Func&& work)
+        {
+            return {*this, req.io_context, std::forward<Func>(work)};
+        }
+#endif
+
+    private:
+        static void complete(asio::io_context* io_context, response& res, response&& result)
+        {
+            auto finish = [&res, result = std::move(result)]() mutable {
+                res = std::move(result);
+                res.end();
+            };
+            if (io_context)
+                asio::post(*io_context, std::move(finish));
+            else
+                finish();
+        }
+
+        void worker_loop()
+        {
+            detail::unique_task task;
+            for (;;)
+            {
+                if (queue_.try_pop(task))
+                {
+                    pending_.fetch_sub(1);
+                    task();
+                    task = detail::unique_task();
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(mutex_);
+                sleepers_.fetch_add(1);
+                cv_.wait(lock, [this] {
+                    return stopping_ || pending_.load() > 0;
+                });
+                sleepers_.fetch_sub(1);
+                if (stopping_ && pending_.load() == 0)
+                    return;
+            }
+        }
+
+        detail::mpmc_queue<detail::unique_task> queue_;
+        std::vector<std::thread> workers_;
+
+        // Only used to park idle workers, never on the submission path unless someone is asleep.
+        std::mutex mutex_;
+        std::condition_variable cv_;
+        std::atomic<size_t> pending_{0};
+        std::atomic<size_t> sleepers_{0};
+        bool stopping_{false};
+    };
+
+#ifdef CROW_CAN_USE_COROUTINES
+    template<typename Func>
+    bool detail::executor_awaitable<Func>::await_suspend(std::coroutine_handle<> awaiting)
+    {
+        bool queued = executor_.try_submit([this, awaiting] {
+            try
+            {
+                if constexpr (std::is_void<result_type>::value)
+                {
+                    work_();
+                    result_.emplace();
+                }
+                else
+                    result_.emplace(work_());
+            }
+            catch (...)
+            {
+                error_ = std::current_exception();
+            }
+            if (io_context_)
+                asio::post(*io_context_, [awaiting] {
+                    awaiting.resume();
+                });
+            else
+                awaiting.resume();
+        });
+        if (!queued)
+        {
+            error_ = std::make_exception_ptr(executor_full());
+            return false;
+        }
+        return true;
+    }
+#endif
+} // namespace crow
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <fcntl.h>
+// S_ISREG is not defined for windows
+// This defines it like suggested in https://stackoverflow.com/a/62371749
+#if defined(_MSC_VER)
+#define _CRT_INTERNAL_NONSTDC_NAMES 1
+#endif
+#include <sys/stat.h>
+#if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
+#define S_ISREG(m) (((m) & S_IFMT) == S_IFREG)
+#endif
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/sendfile.h>
+/// Static files go from the page cache straight to plain TCP sockets with sendfile(2).
+#define CROW_HAS_SENDFILE
+#endif
+
+#include "crow/settings.h"
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// Whether two `stat` results of the same path describe the same version of the same file.
+        inline bool same_file(const struct stat& a, const struct stat& b)
+        {
+            return a.st_ino == b.st_ino && a.st_dev == b.st_dev && a.st_size == b.st_size && a.st_mtime == b.st_mtime
+#ifdef __linux__
+                   && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec
+#endif
+              ;
+        }
+
+        /// An open static file, shared by every response that is sending it. Closed once the last one is done.
+        struct cached_file
+        {
+            int fd = -1;
+            struct stat statbuf;
+
+            cached_file() = default;
+            cached_file(const cached_file&) = delete;
+            cached_file& operator=(const cached_file&) = delete;
+
+            ~cached_file()
+            {
+                if (fd >= 0)
+                    ::close(fd);
+            }
+
+            /// Read up to `size` bytes at `offset` without moving a shared file position. Returns the bytes read.
+            std::size_t read(char* buffer, std::size_t size, uint64_t offset) const
+            {
+#ifdef _WIN32
+                OVERLAPPED overlapped{};
+                overlapped.Offset = static_cast<DWORD>(offset);
+                overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+                DWORD read = 0;
+                if (!ReadFile(reinterpret_cast<HANDLE>(_get_osfhandle(fd)), buffer, static_cast<DWORD>(size), &read, &overlapped))
+                    return 0;
+                return read;
+#else
+                ssize_t read = ::pread(fd, buffer, size, static_cast<off_t>(offset));
+                return read > 0 ? static_cast<std::size_t>(read) : 0;
+#endif
+            }
+
+            /// Whether `other` (a fresh `stat` of the same path) still describes this file.
+            bool same_as(const struct stat& other) const
+            {
+                return same_file(statbuf, other);
+            }
+        };
+
+        /// Least recently used cache of open static files and their `stat` results, shared by all io threads.
+
+        ///
+        /// Every lookup still `stat`s the path, so a file that is rewritten, replaced or removed is noticed on the next
+        /// request. What the cache saves is the `open`, `fstat` and `close` per request.
+        class file_cache
+        {
+        public:
+            explicit file_cache(std::size_t capacity):
+              capacity_(capacity)
+            {}
+
+            /// The cache used for responses set up with \ref response::set_static_file_info().
+            static file_cache& global()
+            {
+                static file_cache cache(CROW_STATIC_FILE_CACHE_SIZE);
+                return cache;
+            }
+
+            /// The open file at `path`, or nullptr if it is not a readable regular file.
+            std::shared_ptr<const cached_file> open(const std::string& path)
+            {
+                struct stat current;
+                if (stat(path.c_str(), &current) != 0 || !S_ISREG(current.st_mode))
+                {
+                    forget(path);
+                    return nullptr;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto it = index_.find(path);
+                    if (it != index_.end())
+                    {
+                        if (it->second->second->same_as(current))
+                        {
+                            lru_.splice(lru_.begin(), lru_, it->second);
+                            return it->second->second;
+                        }
+                        lru_.erase(it->second);
+                        index_.erase(it);
+                    }
+                }
+
+                auto file = std::make_shared<cached_file>();
+#ifdef _WIN32
+                file->fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+                file->fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+                if (file->fd < 0 || fstat(file->fd, &file->statbuf) != 0 || !S_ISREG(file->statbuf.st_mode))
+                    return nullptr;
+
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = index_.find(path);
+                if (it != index_.end())
+                {
+                    // Another thread opened it meanwhile; keep whichever is current.
+                    lru_.erase(it->second);
+                    index_.erase(it);
+                }
+                lru_.emplace_front(path, file);
+                index_.emplace(path, lru_.begin());
+                while (lru_.size() > capacity_)
+                {
+                    index_.erase(lru_.back().first);
+                    lru_.pop_back();
+                }
+                return file;
+            }
+
+        private:
+            void forget(const std::string& path)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto it = index_.find(path);
+                if (it != index_.end())
+                {
+                    lru_.erase(it->second);
+                    index_.erase(it);
+                }
+            }
+
+            using entry = std::pair<std::string, std::shared_ptr<const cached_file>>;
+
+            std::mutex mutex_;
+            std::list<entry> lru_;
+            std::unordered_map<std::string, std::list<entry>::iterator> index_;
+            std::size_t capacity_;
+        };
+    } // namespace detail
+} // namespace crow
@@ -1273,9 +1273,8 @@ reexecute:
 
         switch (parser->header_state) {
           case h_upgrade:
-            // Crow does not support HTTP/2 at the moment.
-            // According to the RFC https://datatracker.ietf.org/doc/html/rfc7540#section-3.2
-            // "A server that does not support HTTP/2 can respond to the request as though the Upgrade header field were absent"
+            // HTTP/2 upgrades are not flagged: the request body is still HTTP/1.1 (https://datatracker.ietf.org/doc/html/rfc7540#section-3.2),
+            // and the connection decides whether to upgrade once the request is complete.
             // => `F_UPGRADE` is not set if the header starts by "h2".
             // This prevents the parser from skipping the request body.
             if (ch != 'h' || p+1 == (data + len) || *(p+1) != '2') {
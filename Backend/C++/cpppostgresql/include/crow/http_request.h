@@ -1,5 +1,7 @@
 #pragma once
 
+#include "crow/settings.h"
+
 #ifdef CROW_USE_BOOST
 #include <boost/asio.hpp>
 #else
@@ -23,9 +25,10 @@ namespace crow // NOTE: Already documented in "crow/app.h"
     template<typename T>
     inline const std::string& get_header_value(const T& headers, const std::string& key)
     {
-        if (headers.count(key))
+        auto it = headers.find(key);
+        if (it != headers.end())
         {
-            return headers.find(key)->second;
+            return it->second;
         }
         static std::string empty;
         return empty;
@@ -55,6 +58,11 @@ namespace crow // NOTE: Already documented in "crow/app.h"
           method(HTTPMethod::Get)
         {}
 
+        /// Construct an empty request whose headers take their memory from `resource`.
+        explicit request(std::pmr::memory_resource* resource):
+          method(HTTPMethod::Get), headers(ci_map::allocator_type(resource))
+        {}
+
         /// Construct a request with all values assigned.
         request(HTTPMethod method_, std::string raw_url_, std::string url_, query_string url_params_, ci_map headers_, std::string body_, unsigned char http_major, unsigned char http_minor, bool has_keep_alive, bool has_close_connection, bool is_upgrade):
           method(method_), raw_url(std::move(raw_url_)), url(std::move(url_)), url_params(std::move(url_params_)), headers(std::move(headers_)), body(std::move(body_)), http_ver_major(http_major), http_ver_minor(http_minor), keep_alive(has_keep_alive), close_connection(has_close_connection), upgrade(is_upgrade)
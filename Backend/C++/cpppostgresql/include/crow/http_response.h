@@ -17,6 +17,8 @@
 #include "crow/http_request.h"
 #include "crow/ci_map.h"
 #include "crow/socket_adaptors.h"
+#include "crow/file_cache.h"
+#include "crow/asset_cache.h"
 #include "crow/logging.h"
 #include "crow/mime_types.h"
 #include "crow/returnable.h"
@@ -27,6 +29,12 @@ namespace crow
     template<typename Adaptor, typename Handler, typename... Middlewares>
     class Connection;
 
+    namespace http2
+    {
+        template<typename Adaptor, typename Handler, typename... Middlewares>
+        class Connection;
+    } // namespace http2
+
     class Router;
 
     /// HTTP response
@@ -34,6 +42,8 @@ namespace crow
     {
         template<typename Adaptor, typename Handler, typename... Middlewares>
         friend class crow::Connection;
+        template<typename Adaptor, typename Handler, typename... Middlewares>
+        friend class crow::http2::Connection;
 
         friend class Router;
 
@@ -241,13 +251,20 @@ namespace crow
                 completed_ = true;
                 if (skip_body)
                 {
-                    set_header("Content-Length", std::to_string(body.size()));
+                    // A static file already has its length; the file just isn't sent.
+                    if (!is_static_type())
+                        set_header("Content-Length", std::to_string(body.size()));
                     body = "";
                     manual_length_header = true;
                 }
                 if (complete_request_handler_)
                 {
-                    complete_request_handler_();
+                    // The handler may hold the last reference to the connection that owns this response
+                    // (e.g. when end() is called from a task posted back by crow::executor),
+                    // so keep it alive until we're done touching members.
+                    auto handler = std::move(complete_request_handler_);
+                    complete_request_handler_ = nullptr;
+                    handler();
                     manual_length_header = false;
                     skip_body = false;
                 }
@@ -282,6 +299,8 @@ namespace crow
             std::string path = "";
             struct stat statbuf;
             int statResult;
+            std::shared_ptr<const detail::cached_file> file; ///< The open file, shared through \ref detail::file_cache.
+            std::shared_ptr<const detail::static_asset> asset; ///< Its in-memory copy, if it is small enough for \ref detail::asset_cache.
         };
 
         /// Return a static file as the response body
@@ -295,16 +314,20 @@ namespace crow
         void set_static_file_info_unsafe(std::string path)
         {
             file_info.path = path;
-            file_info.statResult = stat(file_info.path.c_str(), &file_info.statbuf);
+            file_info.file = detail::file_cache::global().open(path);
+            file_info.statResult = file_info.file ? 0 : -1;
 #ifdef CROW_ENABLE_COMPRESSION
             compressed = false;
 #endif
-            if (file_info.statResult == 0 && S_ISREG(file_info.statbuf.st_mode))
+            if (file_info.file)
             {
+                file_info.statbuf = file_info.file->statbuf;
+                file_info.asset = detail::asset_cache::global().get(path, *file_info.file);
                 std::size_t last_dot = path.find_last_of('.');
                 std::string extension = path.substr(last_dot + 1);
                 code = 200;
                 this->add_header("Content-Length", std::to_string(file_info.statbuf.st_size));
+                this->add_header("Accept-Ranges", "bytes");
 
                 if (!extension.empty())
                 {
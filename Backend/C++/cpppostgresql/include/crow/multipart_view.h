@@ -5,6 +5,7 @@
 #include <vector>
 #include <string_view>
 #include <sstream>
+#include <unordered_map>
 
 #include "crow/http_request.h"
 // for crow::multipart::dd
@@ -1,11 +1,16 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <algorithm>
+#include <memory_resource>
 
 #include "crow/http_request.h"
 #include "crow/http_parser_merged.h"
+#ifdef CROW_USE_SIMD_PARSER
+#include "crow/fast_parser.h"
+#endif
 
 namespace crow
 {
@@ -16,8 +21,10 @@ namespace crow
     template<typename Handler>
     struct HTTPParser : public http_parser
     {
-        static int on_message_begin(http_parser*)
+        static int on_message_begin(http_parser* self_)
         {
+            HTTPParser* self = static_cast<HTTPParser*>(self_);
+            self->url_finished_ = false;
             return 0;
         }
         static int on_method(http_parser* self_)
@@ -30,29 +37,26 @@ namespace crow
         static int on_url(http_parser* self_, const char* at, size_t length)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
-            self->req.raw_url.insert(self->req.raw_url.end(), at, at + length);
-            self->req.url_params = query_string(self->req.raw_url);
-            self->req.url = self->req.raw_url.substr(0, self->qs_point != 0 ? self->qs_point : std::string::npos);
-
-            self->process_url();
-
+            // The URL may arrive in pieces, it is split up and routed once the first header starts.
+            self->req.raw_url.append(at, length);
             return 0;
         }
         static int on_header_field(http_parser* self_, const char* at, size_t length)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
+            self->finish_url();
             switch (self->header_building_state)
             {
                 case 0:
                     if (!self->header_value.empty())
                     {
-                        self->req.headers.emplace(std::move(self->header_field), std::move(self->header_value));
+                        self->add_header();
                     }
-                    self->header_field.assign(at, at + length);
+                    self->header_field = std::string_view(at, length);
                     self->header_building_state = 1;
                     break;
                 case 1:
-                    self->header_field.insert(self->header_field.end(), at, at + length);
+                    extend(self->header_field, self->header_field_storage, at, length);
                     break;
             }
             return 0;
@@ -63,11 +67,11 @@ namespace crow
             switch (self->header_building_state)
             {
                 case 0:
-                    self->header_value.insert(self->header_value.end(), at, at + length);
+                    extend(self->header_value, self->header_value_storage, at, length);
                     break;
                 case 1:
                     self->header_building_state = 0;
-                    self->header_value.assign(at, at + length);
+                    self->header_value = std::string_view(at, length);
                     break;
             }
             return 0;
@@ -75,9 +79,10 @@ namespace crow
         static int on_headers_complete(http_parser* self_)
         {
             HTTPParser* self = static_cast<HTTPParser*>(self_);
+            self->finish_url();
             if (!self->header_field.empty())
             {
-                self->req.headers.emplace(std::move(self->header_field), std::move(self->header_value));
+                self->add_header();
             }
 
             self->set_connection_parameters();
@@ -97,11 +102,14 @@ namespace crow
 
             self->message_complete = true;
             self->process_message();
-            return 0;
+            // A non-zero return stops http_parser_execute() right after this message; feed() turns that back into a pause.
+            return self->paused_ ? 1 : 0;
         }
-        HTTPParser(Handler* handler):
+        HTTPParser(Handler* handler, std::pmr::memory_resource* resource = std::pmr::get_default_resource()):
           http_parser(),
-          handler_(handler)
+          req(resource),
+          handler_(handler),
+          resource_(resource)
         {
             http_parser_init(this);
         }
@@ -110,8 +118,24 @@ namespace crow
         /// Parse a buffer into the different sections of an HTTP request.
         bool feed(const char* buffer, int length)
         {
+            size_t parsed;
+            return feed(buffer, length, parsed) && parsed == static_cast<size_t>(length);
+        }
+
+        /// Parse as much of a buffer as possible, which may hold several pipelined requests.
+
+        ///
+        /// Every complete request is handed to the handler as soon as it is parsed. If the handler calls \ref pause()
+        /// while handling one, parsing stops right after it and `parsed` tells how much of the buffer was used; the rest
+        /// has to be fed again later. Returns false on a parse error.
+        bool feed(const char* buffer, size_t length, size_t& parsed)
+        {
+            paused_ = false;
             if (message_complete)
+            {
+                parsed = length;
                 return true;
+            }
 
             const static http_parser_settings settings_{
               on_message_begin,
@@ -124,12 +148,28 @@ namespace crow
               on_message_complete,
             };
 
-            int nparsed = http_parser_execute(this, &settings_, buffer, length);
-            if (http_errno != CHPE_OK)
+            size_t simple = 0;
+#ifdef CROW_USE_SIMD_PARSER
+            simple = feed_simple(buffer, length);
+            if (http_errno != CHPE_OK || paused_ || body_remaining_ != 0 || (length != 0 && simple == length))
             {
-                return false;
+                parsed = simple;
+                return http_errno == CHPE_OK;
             }
-            return nparsed == length;
+#endif
+            parsed = simple + http_parser_execute(this, &settings_, buffer + simple, length - simple);
+            // A header that continues in the next read can't point into this buffer anymore.
+            keep(header_field, header_field_storage);
+            keep(header_value, header_value_storage);
+            if (paused_ && http_errno == CHPE_CB_message_complete)
+                http_errno = CHPE_OK;
+            return http_errno == CHPE_OK;
+        }
+
+        /// Stop feeding after the request that is being handled.
+        void pause()
+        {
+            paused_ = true;
         }
 
         bool done()
@@ -137,17 +177,166 @@ namespace crow
             return feed(nullptr, 0);
         }
 
+        /// Forget everything, errors included, so the parser can serve a new connection.
+        void reset()
+        {
+            http_parser_init(this);
+            paused_ = false;
+            clear();
+        }
+
         void clear()
         {
-            req = crow::request();
-            header_field.clear();
-            header_value.clear();
+            // The next request on the connection reuses the memory of these strings, unless a large request grew them.
+            std::string raw_url = std::move(req.raw_url), url = std::move(req.url), body = std::move(req.body);
+            req = crow::request(resource_);
+            retain(req.raw_url, raw_url);
+            retain(req.url, url);
+            retain(req.body, body);
+            header_field = {};
+            header_value = {};
+            header_field_storage.clear();
+            header_value_storage.clear();
             header_building_state = 0;
+            url_finished_ = false;
+#ifdef CROW_USE_SIMD_PARSER
+            simple_message_ = false;
+            body_remaining_ = 0;
+#endif
             qs_point = 0;
             message_complete = false;
             state = CROW_NEW_MESSAGE();
         }
 
+#ifdef CROW_USE_SIMD_PARSER
+        /// Parse the requests at the start of a buffer that \ref detail::parse_request_head() takes, and their bodies.
+
+        ///
+        /// Calls the handler just like the http_parser callbacks would. Returns how much of the buffer was used; the rest
+        /// (a request that isn't complete or simple enough, or anything after a pause) goes to http_parser.
+        size_t feed_simple(const char* buffer, size_t length)
+        {
+            if (length == 0)
+            {
+                // The end of the stream, in the middle of a request.
+                if (simple_message_)
+                    http_errno = CHPE_INVALID_EOF_STATE;
+                return 0;
+            }
+
+            const char* p = buffer;
+            const char* end = buffer + length;
+            detail::request_head head;
+            for (;;)
+            {
+                if (body_remaining_ != 0)
+                {
+                    size_t n = static_cast<size_t>(std::min<uint64_t>(body_remaining_, end - p));
+                    req.body.append(p, n);
+                    p += n;
+                    body_remaining_ -= n;
+                    if (body_remaining_ != 0)
+                        break;
+                    complete_simple_message();
+                    if (paused_ || http_errno != CHPE_OK)
+                        break;
+                    continue;
+                }
+
+                // Never in the middle of a request http_parser has started on.
+                if (p == end || state != CROW_NEW_MESSAGE() || !detail::parse_request_head(p, end, head))
+                    break;
+                p += head.size;
+
+                url_finished_ = false;
+                simple_message_ = true;
+                method = static_cast<unsigned>(head.method);
+                req.method = head.method;
+                req.raw_url.append(head.url.data(), head.url.size());
+                finish_url();
+                if (http_errno != CHPE_OK)
+                    break; // The handler gave up on the request already.
+                for (size_t i = 0; i < head.header_count; i++)
+                {
+                    header_field = head.headers[i].name;
+                    header_value = head.headers[i].value;
+                    add_header();
+                }
+                http_major = head.http_major;
+                http_minor = head.http_minor;
+                flags = head.flags;
+                upgrade = 0;
+                set_connection_parameters();
+                process_header();
+
+                if (head.content_length != 0)
+                    body_remaining_ = head.content_length;
+                else
+                {
+                    complete_simple_message();
+                    if (paused_ || http_errno != CHPE_OK)
+                        break;
+                }
+            }
+            return p - buffer;
+        }
+
+        void complete_simple_message()
+        {
+            simple_message_ = false;
+            message_complete = true;
+            process_message();
+        }
+#endif
+
+        /// Split the complete URL into path and query string and let the handler route it.
+        void finish_url()
+        {
+            if (url_finished_)
+                return;
+            size_t query = req.raw_url.find('?');
+            req.url.assign(req.raw_url, 0, query);
+            if (query != std::string::npos)
+                req.url_params = query_string(req.raw_url);
+            process_url();
+            // Set afterwards, as an unknown route completes (and clears) the request right away.
+            url_finished_ = true;
+        }
+
+        void add_header()
+        {
+            req.headers.emplace(header_field, header_value);
+            header_field = {};
+            header_value = {};
+        }
+
+        /// Move a header name or value that points into the buffer being fed into its own storage.
+        static void keep(std::string_view& piece, std::string& storage)
+        {
+            if (piece.data() != storage.data())
+            {
+                storage.assign(piece.data(), piece.size());
+                piece = storage;
+            }
+        }
+
+        /// Add the next piece of a header name or value that was split between two reads.
+        static void extend(std::string_view& piece, std::string& storage, const char* at, size_t length)
+        {
+            keep(piece, storage);
+            storage.append(at, length);
+            piece = storage;
+        }
+
+        static void retain(std::string& target, std::string& previous)
+        {
+            if (previous.capacity() <= retained_capacity)
+            {
+                previous.clear();
+                target = std::move(previous);
+            }
+        }
+
         inline void process_url()
         {
             handler_->handle_url();
@@ -188,12 +377,27 @@ namespace crow
         request req;
 
     private:
+        /// Largest string capacity kept from one request for the next.
+        static constexpr size_t retained_capacity = 4096;
+
         int header_building_state = 0;
         bool message_complete = false;
-        std::string header_field;
-        std::string header_value;
+        bool paused_ = false;
+        bool url_finished_ = false;
+#ifdef CROW_USE_SIMD_PARSER
+        /// Whether a request that \ref feed_simple() started on isn't complete yet, and how much of its body is missing.
+        bool simple_message_ = false;
+        uint64_t body_remaining_ = 0;
+#endif
+        /// The header being parsed. Both point into the buffer being fed, or into the storage below once a read ends
+        /// in the middle of the header.
+        std::string_view header_field;
+        std::string_view header_value;
+        std::string header_field_storage;
+        std::string header_value_storage;
 
         Handler* handler_; ///< This is currently an HTTP connection object (\ref crow.Connection).
+        std::pmr::memory_resource* resource_; ///< Where the headers of \ref req take their memory from.
     };
 } // namespace crow
 
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace crow // NOTE: Already documented in "crow/app.h"
+{
+    namespace detail
+    {
+        /// The NUMA node a CPU belongs to, 0 where that is unknown.
+        inline int numa_node_of(int cpu)
+        {
+#ifdef __linux__
+            // The kernel lists the node as a "node<N>" entry in the CPU's sysfs directory.
+            DIR* dir = opendir(("/sys/devices/system/cpu/cpu" + std::to_string(cpu)).c_str());
+            if (!dir)
+                return 0;
+            int node = 0;
+            while (dirent* entry = readdir(dir))
+            {
+                std::string name = entry->d_name;
+                if (name.size() > 4 && name.compare(0, 4, "node") == 0 && std::all_of(name.begin() + 4, name.end(), ::isdigit))
+                {
+                    node = std::stoi(name.substr(4));
+                    break;
+                }
+            }
+            closedir(dir);
+            return node;
+#else
+            (void)cpu;
+            return 0;
+#endif
+        }
+
+        /// The CPUs this process may run on, ordered by NUMA node so that neighbouring entries share a node.
+        inline std::vector<int> allowed_cpus()
+        {
+            std::vector<int> cpus;
+#ifdef __linux__
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            if (sched_getaffinity(0, sizeof(set), &set) != 0)
+                return cpus;
+            std::vector<std::pair<int, int>> by_node;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                if (CPU_ISSET(cpu, &set))
+                    by_node.emplace_back(numa_node_of(cpu), cpu);
+            std::sort(by_node.begin(), by_node.end());
+            for (auto& entry : by_node)
+                cpus.push_back(entry.second);
+#endif
+            return cpus;
+        }
+
+        /// Bind the calling thread to one CPU. Returns false where that is not possible.
+        inline bool pin_current_thread(int cpu)
+        {
+#ifdef __linux__
+            if (cpu < 0 || cpu >= CPU_SETSIZE)
+                return false;
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+            (void)cpu;
+            return false;
+#endif
+        }
+    } // namespace detail
+} // namespace crow
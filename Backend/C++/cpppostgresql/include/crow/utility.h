@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <tuple>
 #include <type_traits>
+#include <utility>
 #include <cstring>
 #include <cctype>
 #include <functional>
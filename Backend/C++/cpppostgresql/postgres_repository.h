@@ -0,0 +1,103 @@
+#pragma once
+
+#include <pqxx/pqxx>        // libpqxx for PostgreSQL
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../common/list_repository.h"
+
+// Lists in the "lists" table of a PostgreSQL database.
+//
+// Blocking pqxx calls run on an executor instead of Crow's io threads, so a
+// slow query only holds up its own request. Each task opens its own
+// connection, so up to `connections` queries run at once.
+class PostgresListRepository : public ListRepository
+{
+public:
+    explicit PostgresListRepository(std::string conn_str, size_t connections = 8):
+      conn_str_(std::move(conn_str)), executor_(connections)
+    {}
+
+private:
+    static ListItem item_of(const pqxx::row& row)
+    {
+        return ListItem{row["id"].c_str(), row["list"].c_str()};
+    }
+
+    // Awaitable query: runs f(txn) on its own connection in the executor,
+    // commits, and resumes the calling handler on its io thread with the result.
+    template<typename Txn = pqxx::nontransaction, typename Func>
+    auto query(const crow::request& req, Func f)
+    {
+        return executor_.async(req, [this, f = std::move(f)] {
+            pqxx::connection c(conn_str_);
+            Txn txn(c);
+            pqxx::result r = f(txn);
+            txn.commit();
+            return r;
+        });
+    }
+
+public:
+    crow::task<ListItem> create(const crow::request& req, std::string list) override
+    {
+        pqxx::result r = co_await query<pqxx::work>(req, [list = std::move(list)](pqxx::work& txn) {
+            return txn.exec_params(
+                "INSERT INTO lists (list) VALUES ($1) RETURNING id, list",
+                list
+            );
+        });
+        if (r.size() != 1)
+            throw std::runtime_error("INSERT returned no row");
+        co_return item_of(r[0]);
+    }
+
+    crow::task<std::vector<ListItem>> all(const crow::request& req) override
+    {
+        pqxx::result r = co_await query(req, [](pqxx::nontransaction& txn) {
+            return txn.exec("SELECT id, list FROM lists ORDER BY id");
+        });
+        std::vector<ListItem> items;
+        items.reserve(r.size());
+        for (const auto &row : r)
+            items.push_back(item_of(row));
+        co_return items;
+    }
+
+    crow::task<std::optional<ListItem>> get(const crow::request& req, std::string id) override
+    {
+        pqxx::result r = co_await query(req, [id = std::move(id)](pqxx::nontransaction& txn) {
+            return txn.exec_params("SELECT id, list FROM lists WHERE id = $1", id);
+        });
+        if (r.size() != 1)
+            co_return std::nullopt;
+        co_return item_of(r[0]);
+    }
+
+    crow::task<std::optional<ListItem>> update(const crow::request& req, std::string id, std::string list) override
+    {
+        pqxx::result r = co_await query<pqxx::work>(req, [id = std::move(id), list = std::move(list)](pqxx::work& txn) {
+            return txn.exec_params(
+                "UPDATE lists SET list = $1 WHERE id = $2 RETURNING id, list",
+                list, id
+            );
+        });
+        if (r.size() != 1)
+            co_return std::nullopt;
+        co_return item_of(r[0]);
+    }
+
+    crow::task<bool> remove(const crow::request& req, std::string id) override
+    {
+        pqxx::result r = co_await query<pqxx::work>(req, [id = std::move(id)](pqxx::work& txn) {
+            return txn.exec_params("DELETE FROM lists WHERE id = $1", id);
+        });
+        co_return r.affected_rows() > 0;
+    }
+
+private:
+    std::string conn_str_;
+    crow::executor executor_;
+};